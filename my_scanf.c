@@ -1,851 +1,4317 @@
+// flockfile() and funlockfile() are POSIX, not C11, so ask for them before any include
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <limits.h>
+#include <float.h>
 
-int read_int(const va_list args, int width, char size_modifier, int suppress) {
-    int c;
-    int sign = 1;
-    long long value = 0;
-    int digit_count = 0;
-    int chars_read = 0;
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-    // Consume all leading whitespace
-    while ((c = getchar()) != EOF && isspace(c)) {}
+#include "my_scanf.h"
+
+// Bytes read from a stream at a time by the window based entry points
+#define SCAN_WINDOW_SIZE 65536
+
+// Characters my_scanf can put back or roll back, ungetc() only promises 1
+// (windows can roll back any distance)
+#define SCAN_LOOKAHEAD 64
+
+// How far a stream input got, only counted for my_scanf_ex so plain my_scanf
+// doesn't pay for it on every character
+typedef struct {
+    size_t fetched;                // characters taken from the stream, put back ones are in pushed
+    size_t newlines;               // how many of them were newlines
+    size_t line_starts[SCAN_LOOKAHEAD + 1];  // fetched count where each line started, by newlines
+                                             // modulo the size, enough for every pushed one to go back
+} scan_position;
+
+// What the input remembers so checkpoints can be rolled back
+typedef struct {
+    size_t offset;               // where data[0] is in the whole input, checkpoints are counted from the start
+    int marks;                   // checkpoints that haven't been rolled back or released yet
+    size_t oldest_mark;          // the first of them, refills keep everything from here on
+    int pushed[SCAN_LOOKAHEAD];  // characters put back in stream mode, the last one is read next
+    int pushed_count;
+    char journal[SCAN_LOOKAHEAD];  // characters read in stream mode since the oldest checkpoint
+    size_t journal_length;         // can go past SCAN_LOOKAHEAD, then there's no rolling back
+    scan_position *position;       // counted by next_char and unread_char when not NULL
+} scan_history;
+
+// Where the readers pull their characters from.
+// my_scanf reads stdin one character at a time with getc()/ungetc() like always,
+// the other entry points read straight out of a window of memory instead
+typedef struct {
+    FILE *stream;                // read from here one character at a time, NULL means use the window
+    const char *data;            // window of input in memory
+    size_t pos;                  // next unread byte in the window
+    size_t length;               // end of the window, reading stops here
+    const uint64_t *space_bits;  // stage 1 whitespace bitmap (1 bit per byte of data), NULL if not indexed
+    FILE *source;                // refills the window with fread() once it runs out, NULL for fixed memory
+    char *buffer;                // storage behind the window when it is refilled from source
+    size_t capacity;
+    int more_coming;             // the push parser will be fed more bytes later, so running out isn't EOF
+    int starved;                 // ran out of bytes while more_coming was set
+    scan_history history;        // for checkpoints, starts out all zero
+} scan_input;
+
+// Where the converted values get stored. Normally the pointers come straight out of
+// the caller's va_list, but the push parser keeps its own copy of them because
+// a va_list can't be used after the call that started it returns
+typedef struct {
+    va_list *list;               // take pointers from here when not NULL
+    void **pointers;             // otherwise from this array
+    int next;                    // next pointer in the array
+} scan_args;
+
+// Same as va_arg(args, T*) for whichever kind of argument list we have
+void *next_arg(scan_args *args) {
+    if (args->list != NULL) {
+        return va_arg(*args->list, void *);
+    }
+    return args->pointers[args->next++];
+}
+
+// Index of the lowest set bit, word must not be 0
+int lowest_set_bit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+// Keeps other threads off a stream while we read a whole run of records from it
+void lock_stream(FILE *stream) {
+#ifdef _WIN32
+    _lock_file(stream);
+#else
+    flockfile(stream);
+#endif
+}
+
+void unlock_stream(FILE *stream) {
+#ifdef _WIN32
+    _unlock_file(stream);
+#else
+    funlockfile(stream);
+#endif
+}
+
+// Reads the next chunk of the source into the window once everything in it was consumed
+// The last byte stays in front of it so it can still be put back, and with a checkpoint
+// open everything from the checkpoint on stays (the buffer grows if it has to)
+// Returns 0 at the end of the source
+int refill_window(scan_input *in) {
+    if (in->source == NULL) {
+        return 0;
+    }
+
+    size_t from = in->length > 0 ? in->length - 1 : 0;
+    if (in->history.marks > 0) {
+        from = in->history.oldest_mark - in->history.offset;
+    }
+    size_t keep = in->length - from;
+
+    if (keep == in->capacity) {
+        char *bigger = realloc(in->buffer, in->capacity * 2);
+        if (bigger == NULL) {
+            return 0;
+        }
+        in->buffer = bigger;
+        in->capacity *= 2;
+    }
+
+    memmove(in->buffer, in->buffer + from, keep);
+    in->data = in->buffer;
+    in->history.offset += from;
+    in->pos = keep;
+
+    size_t got = fread(in->buffer + keep, 1, in->capacity - keep, in->source);
+    in->length = keep + got;
+    return got > 0;
+}
+
+// Bytes left in the window, refilling it first if it's empty
+// Returns 0 at the end of the input, the same place next_char would return EOF
+size_t window_available(scan_input *in) {
+    if (in->pos >= in->length && !refill_window(in)) {
+        in->starved = in->more_coming;
+        return 0;
+    }
+    return in->length - in->pos;
+}
+
+// Length of the run of non whitespace bytes at the start of bytes (at most n)
+// Uses the stage 1 bitmap when there is one, otherwise compares 16 bytes at a time
+size_t find_space(const scan_input *in, const char *bytes, size_t n) {
+    size_t i = 0;
+
+    if (in->space_bits != NULL) {
+        size_t pos = bytes - in->data;
+        while (i < n) {
+            uint64_t spaces = in->space_bits[(pos + i) / 64] >> ((pos + i) % 64);
+            if (spaces != 0) {
+                i += lowest_set_bit(spaces);
+                break;
+            }
+            i += 64 - (pos + i) % 64;
+        }
+        return i < n ? i : n;
+    }
+
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i four = _mm_set1_epi8(4);
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(bytes + i));
+        // Same whitespace test as classify_block, ' ' or '\t' through '\r'
+        __m128i shifted = _mm_sub_epi8(chunk, tab);
+        __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, four), shifted);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), is_control));
+        if (mask != 0) {
+            return i + lowest_set_bit((unsigned)mask);
+        }
+    }
+#endif
+
+    // Whatever is left over (everything without SSE2) one byte at a time
+    for (; i < n; i++) {
+        unsigned char c = (unsigned char)bytes[i];
+        if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            break;
+        }
+    }
+    return i;
+}
+
+// Same as getchar() but for whichever input we are scanning
+int next_char(scan_input *in) {
+    if (in->stream != NULL) {
+        int c;
+        if (in->history.pushed_count > 0) {
+            c = in->history.pushed[--in->history.pushed_count];
+        } else {
+            c = getc(in->stream);
+            // Only count what comes from the stream, what's put back is worked out
+            // from the pushed characters in describe_position when it's needed
+            scan_position *position = in->history.position;
+            if (position != NULL && c != EOF) {
+                position->fetched++;
+                if (c == '\n') {
+                    position->newlines++;
+                    position->line_starts[position->newlines % (SCAN_LOOKAHEAD + 1)] = position->fetched;
+                }
+            }
+        }
+        // Remember it in case a checkpoint is rolled back
+        if (in->history.marks > 0 && c != EOF) {
+            if (in->history.journal_length < SCAN_LOOKAHEAD) {
+                in->history.journal[in->history.journal_length] = (char)c;
+            }
+            in->history.journal_length++;
+        }
+        return c;
+    }
+    if (in->pos < in->length || refill_window(in)) {
+        return (unsigned char)in->data[in->pos++];
+    }
+    // Not really the end when more bytes are on the way, remember that we needed them
+    in->starved = in->more_coming;
+    return EOF;
+}
 
+// Same as ungetc(), putting back EOF does nothing
+// Can be done several times in a row, unlike ungetc()
+void unread_char(scan_input *in, int c) {
     if (c == EOF) {
-        return 0;  // Failed to read anything
+        return;
+    }
+    if (in->stream != NULL) {
+        if (in->history.marks > 0 && in->history.journal_length > 0) {
+            in->history.journal_length--;
+        }
+        if (in->history.pushed_count < SCAN_LOOKAHEAD) {
+            in->history.pushed[in->history.pushed_count++] = c;
+        } else {
+            // Going back to the stream, next_char will count it again
+            ungetc(c, in->stream);
+            scan_position *position = in->history.position;
+            if (position != NULL) {
+                position->fetched--;
+                if (c == '\n') {
+                    position->newlines--;
+                }
+            }
+        }
+    } else {
+        in->pos--;
     }
+}
 
-    // Check for optional sign
-    if (c == '+' || c == '-') {
-        if (c == '-') {
-            sign = -1;
+// Remembers where the input is so rollback can go back there, however much is read
+// in between (in stream mode up to SCAN_LOOKAHEAD characters)
+// Every checkpoint is ended by rollback or release_checkpoint, newest first
+size_t checkpoint(scan_input *in) {
+    if (in->history.marks++ == 0) {
+        in->history.journal_length = 0;
+        in->history.oldest_mark = in->history.offset + in->pos;
+    }
+    return in->stream != NULL ? in->history.journal_length : in->history.offset + in->pos;
+}
+
+// Puts back everything read since the checkpoint and ends it
+// Returns 0 if a stream read more since then than it can put back, the input
+// is left where it is then
+int rollback(scan_input *in, size_t mark) {
+    in->history.marks--;
+    if (in->stream == NULL) {
+        in->pos = mark - in->history.offset;
+        return 1;
+    }
+
+    size_t end = in->history.journal_length;
+    if (end > SCAN_LOOKAHEAD || end - mark > (size_t)(SCAN_LOOKAHEAD - in->history.pushed_count)) {
+        return 0;
+    }
+    // Hand the characters back newest first, same as unread_char would
+    while (end > mark) {
+        in->history.pushed[in->history.pushed_count++] = (unsigned char)in->history.journal[--end];
+    }
+    in->history.journal_length = mark;
+    return 1;
+}
+
+// Ends the checkpoint and keeps what was read since
+void release_checkpoint(scan_input *in) {
+    in->history.marks--;
+}
+
+// Gives the characters that were put back but not read again back to the stream
+// at the end of a call, so the next call (or getc) sees them
+// Only 1 is guaranteed to fit back into a FILE, more only works where ungetc allows it
+void finish_input(scan_input *in) {
+    if (in->stream == NULL) {
+        return;
+    }
+    for (int i = 0; i < in->history.pushed_count; i++) {
+        ungetc(in->history.pushed[i], in->stream);
+    }
+    in->history.pushed_count = 0;
+}
+
+// Consume all whitespace and return the first non whitespace character (or EOF)
+// When the input was indexed we jump straight to the next token using the bitmap
+// instead of testing every separator byte with isspace
+int skip_whitespace(scan_input *in) {
+    int c;
+
+    if (in->stream == NULL && in->space_bits != NULL) {
+        size_t pos = in->pos;
+        while (pos < in->length) {
+            // Flip the bits so non whitespace bytes are 1s, then drop the bytes behind us
+            uint64_t tokens = ~in->space_bits[pos / 64] >> (pos % 64);
+            if (tokens != 0) {
+                pos += lowest_set_bit(tokens);
+                break;
+            }
+            // Whole rest of this word is whitespace, go to the start of the next one
+            pos = (pos / 64 + 1) * 64;
         }
-        chars_read++;
+        in->pos = pos < in->length ? pos : in->length;
+        return next_char(in);
+    }
 
-        // Check if we've hit width limit after just the sign
-        // Don't check if the width limit is set to 0 ie unlimited
-        if (width > 0 && chars_read >= width) {
-            return 0;  // No digits read, just a sign
+    while ((c = next_char(in)) != EOF && isspace(c)) {}
+    return c;
+}
+
+// Settings like the %m arena are kept per thread so records can be scanned on several threads at once
+#ifdef _WIN32
+#define SCAN_THREAD_LOCAL __declspec(thread)
+#else
+#define SCAN_THREAD_LOCAL _Thread_local
+#endif
+
+// Storage that %m conversions get carved out of, NULL means plain malloc
+SCAN_THREAD_LOCAL my_scan_arena *current_arena = NULL;
+
+// Header in front of every block we malloc because the arena memory ran out
+// It's padded so what follows it (block + 1) is aligned for any type, %#m arrays need that
+struct my_scan_arena_block {
+    my_scan_arena_block *next;
+    max_align_t data[];
+};
+
+void my_scan_arena_init(my_scan_arena *arena, void *memory, size_t size) {
+    arena->memory = memory;
+    arena->size = memory != NULL ? size : 0;
+    arena->used = 0;
+    arena->overflow = NULL;
+}
+
+// Gives back everything allocated since the arena had used bytes and overflow blocks
+void rewind_arena(my_scan_arena *arena, size_t used, my_scan_arena_block *overflow) {
+    // Only blocks that didn't fit have to be freed, normally there are none
+    while (arena->overflow != overflow) {
+        my_scan_arena_block *next = arena->overflow->next;
+        free(arena->overflow);
+        arena->overflow = next;
+    }
+    arena->used = used;
+}
+
+void my_scan_arena_reset(my_scan_arena *arena) {
+    rewind_arena(arena, 0, NULL);
+}
+
+void my_scan_set_arena(my_scan_arena *arena) {
+    current_arena = arena;
+}
+
+// malloc'd %m results of a record the push parser may still have to parse again,
+// it frees them if the record turns out to be unfinished (see push_records)
+typedef struct {
+    char **results;
+    size_t count;
+    size_t capacity;
+} scan_allocations;
+
+// Set while the push parser runs a record, NULL the rest of the time
+SCAN_THREAD_LOCAL scan_allocations *current_allocations = NULL;
+
+// Adds result to the list, returns 0 when out of memory
+int remember_allocation(scan_allocations *allocations, char *result) {
+    if (allocations->count == allocations->capacity) {
+        size_t capacity = allocations->capacity > 0 ? allocations->capacity * 2 : 8;
+        char **bigger = realloc(allocations->results, capacity * sizeof(char *));
+        if (bigger == NULL) {
+            return 0;
+        }
+        allocations->results = bigger;
+        allocations->capacity = capacity;
+    }
+    allocations->results[allocations->count++] = result;
+    return 1;
+}
+
+// Copies length bytes plus a null terminator into the arena (or a block it owns if it's full)
+// Returns NULL when out of memory
+char *arena_copy(my_scan_arena *arena, const char *src, size_t length) {
+    char *copy;
+
+    if (arena->memory != NULL && arena->size - arena->used > length) {
+        copy = arena->memory + arena->used;
+        arena->used += length + 1;
+    } else {
+        my_scan_arena_block *block = malloc(sizeof(my_scan_arena_block) + length + 1);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = arena->overflow;
+        arena->overflow = block;
+        copy = (char *)(block + 1);
+    }
+
+    memcpy(copy, src, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// Table that %ks conversions look their strings up in, NULL means %ks fails
+SCAN_THREAD_LOCAL my_scan_intern *current_intern = NULL;
+
+// One entry of the open addressing table, string is NULL when the slot is empty
+struct my_scan_intern_slot {
+    uint64_t hash;
+    const char *string;
+    size_t length;
+};
+
+void my_scan_intern_init(my_scan_intern *table) {
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
+    my_scan_arena_init(&table->storage, NULL, 0);
+    table->scratch = NULL;
+    table->scratch_capacity = 0;
+}
+
+void my_scan_intern_free(my_scan_intern *table) {
+    free(table->slots);
+    free(table->scratch);
+    my_scan_arena_reset(&table->storage);
+    my_scan_intern_init(table);
+}
+
+void my_scan_set_intern(my_scan_intern *table) {
+    current_intern = table;
+}
+
+// Hashes a token 8 bytes at a time instead of one, tokens are short so this is
+// a handful of multiplies for most of them
+uint64_t hash_token(const char *token, size_t length) {
+    uint64_t hash = length * 0x9E3779B97F4A7C15ULL;
+    uint64_t word;
+
+    while (length >= 8) {
+        memcpy(&word, token, 8);
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9ULL;
+        hash ^= hash >> 31;
+        token += 8;
+        length -= 8;
+    }
+
+    // Last 0 to 7 bytes, zero padded
+    word = 0;
+    memcpy(&word, token, length);
+    hash = (hash ^ word) * 0x94D049BB133111EBULL;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+// Doubles the number of slots and puts every string back in its new slot
+int grow_intern(my_scan_intern *table) {
+    size_t capacity = table->capacity > 0 ? table->capacity * 2 : 64;
+    my_scan_intern_slot *slots = calloc(capacity, sizeof(my_scan_intern_slot));
+    if (slots == NULL) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->slots[i].string != NULL) {
+            size_t slot = table->slots[i].hash & (capacity - 1);
+            while (slots[slot].string != NULL) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            slots[slot] = table->slots[i];
+        }
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+    return 1;
+}
+
+// Returns the one stored copy of token, copying it in the first time we see it
+// Returns NULL when out of memory
+const char *intern_string(my_scan_intern *table, const char *token, size_t length) {
+    // Keep at least half the slots empty so probes stay short
+    if (table->count * 2 >= table->capacity && !grow_intern(table)) {
+        return NULL;
+    }
+
+    uint64_t hash = hash_token(token, length);
+    size_t mask = table->capacity - 1;
+    size_t slot = hash & mask;
+
+    // Linear probing until we find the string or an empty slot
+    while (table->slots[slot].string != NULL) {
+        my_scan_intern_slot *entry = &table->slots[slot];
+        if (entry->hash == hash && entry->length == length && memcmp(entry->string, token, length) == 0) {
+            return entry->string;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    const char *copy = arena_copy(&table->storage, token, length);
+    if (copy == NULL) {
+        return NULL;
+    }
+    table->slots[slot].hash = hash;
+    table->slots[slot].string = copy;
+    table->slots[slot].length = length;
+    table->count++;
+    return copy;
+}
+
+// Where the characters of %s, %c and %N go: straight into the caller's buffer,
+// for %m conversions into storage we allocate as it grows, and for %ks into the
+// intern table's scratch buffer until we know if the string is new
+typedef struct {
+    char *dest;                   // caller's buffer or the storage we allocated
+    size_t length;
+    size_t capacity;              // SIZE_MAX for the caller's buffer, we can't know its real size
+    int allocate;                 // %m or %k conversion
+    my_scan_arena *arena;         // arena to allocate from, NULL for plain malloc
+    my_scan_arena_block *block;   // malloc'd storage when the arena didn't have room
+    my_scan_intern *intern;       // %k conversion, dest is the table's scratch buffer
+} text_output;
+
+// Characters go straight into a buffer the caller gave us
+void start_text(text_output *out, char *dest) {
+    out->dest = dest;
+    out->length = 0;
+    out->capacity = SIZE_MAX;
+    out->allocate = 0;
+    out->arena = NULL;
+    out->block = NULL;
+    out->intern = NULL;
+}
+
+// Characters go into new storage, the string is written in place at the end of the arena
+// and only claimed once we know how long it ended up
+void start_allocated_text(text_output *out, my_scan_arena *arena) {
+    out->length = 0;
+    out->allocate = 1;
+    out->arena = arena;
+    out->block = NULL;
+    out->intern = NULL;
+
+    if (out->arena != NULL && out->arena->memory != NULL) {
+        out->dest = out->arena->memory + out->arena->used;
+        out->capacity = out->arena->size - out->arena->used;
+    } else {
+        out->dest = NULL;
+        out->capacity = 0;
+    }
+}
+
+// Characters go into the table's scratch buffer, which grows like plain malloc'd text
+// and is handed back to the table when we're done with it
+void start_interned_text(text_output *out, my_scan_intern *table) {
+    out->dest = table->scratch;
+    out->length = 0;
+    out->capacity = table->scratch_capacity;
+    out->allocate = 1;
+    out->arena = NULL;
+    out->block = NULL;
+    out->intern = table;
+}
+
+// Moves allocated text somewhere bigger, returns 0 when out of memory
+int grow_text(text_output *out) {
+    size_t capacity = out->capacity < 16 ? 32 : out->capacity * 2;
+
+    if (out->arena == NULL) {
+        char *bigger = realloc(out->dest, capacity);
+        if (bigger == NULL) {
+            return 0;
+        }
+        out->dest = bigger;
+    } else {
+        // Didn't fit in the arena, keep going in a block the arena frees on reset
+        my_scan_arena_block *bigger = realloc(out->block, sizeof(my_scan_arena_block) + capacity);
+        if (bigger == NULL) {
+            return 0;
+        }
+        // First time out of the arena, bring along what was already written there
+        if (out->block == NULL && out->length > 0) {
+            memcpy(bigger + 1, out->dest, out->length);
+        }
+        out->block = bigger;
+        out->dest = (char *)(bigger + 1);
+    }
+
+    out->capacity = capacity;
+    return 1;
+}
+
+int put_char(text_output *out, char c) {
+    if (out->length == out->capacity && !grow_text(out)) {
+        return 0;
+    }
+    out->dest[out->length++] = c;
+    return 1;
+}
+
+// Same as put_char for a whole run of characters at once
+int put_chars(text_output *out, const char *chars, size_t count) {
+    if (count == 0) {
+        return 1;
+    }
+    while (out->capacity - out->length < count) {
+        if (!grow_text(out)) {
+            return 0;
+        }
+    }
+    memcpy(out->dest + out->length, chars, count);
+    out->length += count;
+    return 1;
+}
+
+// Finishes the text (with a null terminator unless it's %c) and for %m conversions
+// hands the exact size storage to the caller's char* pointer
+// Returns 0 when out of memory
+int finish_text(text_output *out, char **result, int terminate) {
+    if (terminate) {
+        if (!put_char(out, '\0')) {
+            return 0;
+        }
+        out->length--;
+    }
+    if (!out->allocate) {
+        return 1;
+    }
+
+    if (out->intern != NULL) {
+        // Scratch buffer goes back to the table whether or not the string was new
+        const char *interned = intern_string(out->intern, out->dest, out->length);
+        out->intern->scratch = out->dest;
+        out->intern->scratch_capacity = out->capacity;
+        if (interned == NULL) {
+            return 0;
+        }
+        *result = (char *)interned;
+        return 1;
+    }
+
+    size_t size = out->length + (terminate ? 1 : 0);
+
+    if (out->arena == NULL) {
+        // Plain malloc, shrink it down to the exact size (the caller frees it)
+        char *exact = realloc(out->dest, size > 0 ? size : 1);
+        if (exact == NULL) {
+            exact = out->dest;
+        }
+        if (current_allocations != NULL && !remember_allocation(current_allocations, exact)) {
+            free(exact);
+            return 0;
+        }
+        *result = exact;
+    } else if (out->block == NULL) {
+        // Fit in the arena, claim the bytes we wrote
+        out->arena->used += size;
+        *result = out->dest;
+    } else {
+        my_scan_arena_block *exact = realloc(out->block, sizeof(my_scan_arena_block) + size);
+        if (exact != NULL) {
+            out->block = exact;
+        }
+        out->block->next = out->arena->overflow;
+        out->arena->overflow = out->block;
+        *result = (char *)(out->block + 1);
+    }
+    return 1;
+}
+
+// Throws away allocated text when the conversion failed after all
+void discard_text(text_output *out) {
+    if (!out->allocate) {
+        return;
+    }
+    if (out->intern != NULL) {
+        // Not ours to free, the table keeps its scratch buffer
+        out->intern->scratch = out->dest;
+        out->intern->scratch_capacity = out->capacity;
+    } else if (out->arena == NULL) {
+        free(out->dest);
+    } else {
+        free(out->block);
+    }
+}
+
+// What happens when a number doesn't fit in the variable it's stored in, set per thread
+SCAN_THREAD_LOCAL my_scan_overflow overflow_policy = MY_SCAN_OVERFLOW_WRAP;
+
+// Conversions that overflowed since the current call started
+SCAN_THREAD_LOCAL int overflow_count = 0;
+
+void my_scan_set_overflow(my_scan_overflow policy) {
+    overflow_policy = policy;
+}
+
+int my_scan_overflowed(void) {
+    return overflow_count;
+}
+
+// value = value * base + digit, returns 1 if the result didn't fit in 64 bits (it wraps around)
+// Only called once a number has enough digits that it might not fit, so the
+// common short numbers never pay for the check
+int mul_add_overflows(unsigned long long *value, unsigned base, unsigned digit) {
+#if defined(__GNUC__) || defined(__clang__)
+    int overflow = __builtin_mul_overflow(*value, base, value);
+    overflow |= __builtin_add_overflow(*value, digit, value);
+    return overflow;
+#else
+    int overflow = *value > (ULLONG_MAX - digit) / base;
+    *value = *value * base + digit;
+    return overflow;
+#endif
+}
+
+// Largest value each size modifier can hold as a signed number
+unsigned long long signed_max(char size_modifier) {
+    switch (size_modifier) {
+        case 'H': return SCHAR_MAX;
+        case 'h': return SHRT_MAX;
+        case 'l': return LONG_MAX;
+        case 'L': return LLONG_MAX;
+        default:  return INT_MAX;
+    }
+}
+
+// Largest value each size modifier can hold as an unsigned number
+unsigned long long unsigned_max(char size_modifier) {
+    switch (size_modifier) {
+        case 'H': return UCHAR_MAX;
+        case 'h': return USHRT_MAX;
+        case 'l': return ULONG_MAX;
+        case 'L': return ULLONG_MAX;
+        default:  return UINT_MAX;
+    }
+}
+
+// Checks a signed conversion against the range of its variable, applies the overflow
+// policy and stores it. magnitude is the number without its sign, overflow is set when
+// it didn't even fit in 64 bits
+// Returns 0 when the policy says an overflow is a matching failure
+int store_signed(scan_args *args, char size_modifier, int suppress, int negative, unsigned long long magnitude, int overflow) {
+    unsigned long long max = signed_max(size_modifier);
+    // One more on the negative side, -128 fits in a signed char but 128 doesn't
+    unsigned long long limit = negative ? max + 1 : max;
+    long long value;
+
+    if (overflow || magnitude > limit) {
+        overflow_count++;
+        if (overflow_policy == MY_SCAN_OVERFLOW_FAIL) {
+            return 0;
+        }
+        if (overflow_policy == MY_SCAN_OVERFLOW_SATURATE) {
+            magnitude = limit;
+        }
+    }
+    // Unsigned math so wrapping is well defined, the cast below truncates like before
+    value = (long long)(negative ? 0ULL - magnitude : magnitude);
+
+    // Get the pointer (next argument from the caller) to where we should store the result we read
+    // Store based on size modifier, but do not store the value if assignment suppression
+    if (!suppress) {
+        if (size_modifier == 'h') {
+            // short
+            short *ptr = next_arg(args);
+            *ptr = (short)value;
+        } else if (size_modifier == 'H') {
+            // char (hh modifier - using 'H' to represent)
+            signed char *ptr = next_arg(args);
+            *ptr = (signed char)value;
+        } else if (size_modifier == 'l') {
+            // long
+            long *ptr = next_arg(args);
+            *ptr = (long)value;
+        } else if (size_modifier == 'L') {
+            // long long (ll modifier - using 'L' to represent)
+            long long *ptr = next_arg(args);
+            *ptr = value;
+        } else {
+            // regular int (default)
+            int *ptr = next_arg(args);
+            *ptr = (int)value;
+        }
+    }
+    return 1;
+}
+
+// Same as store_signed for the unsigned conversions (%u %o %x %b)
+int store_unsigned(scan_args *args, char size_modifier, int suppress, int negative, unsigned long long value, int overflow) {
+    unsigned long long max = unsigned_max(size_modifier);
+
+    if (overflow || value > max) {
+        overflow_count++;
+        if (overflow_policy == MY_SCAN_OVERFLOW_FAIL) {
+            return 0;
+        }
+        if (overflow_policy == MY_SCAN_OVERFLOW_SATURATE) {
+            value = max;
+            negative = 0;
+        }
+    }
+
+    // Like strtoul a minus sign wraps around, -1 is the largest value
+    if (negative) {
+        value = 0ULL - value;
+    }
+
+    // Get the pointer (next argument from the caller) where we should store the result and store based on size modifier
+    // Do not store the value if assignment suppression
+    if (!suppress) {
+        if (size_modifier == 'h') {
+            // unsigned short
+            unsigned short *ptr = next_arg(args);
+            *ptr = (unsigned short)value;
+        } else if (size_modifier == 'H') {
+            // unsigned char (hh modifier - using 'H' to represent)
+            unsigned char *ptr = next_arg(args);
+            *ptr = (unsigned char)value;
+        } else if (size_modifier == 'l') {
+            // unsigned long
+            unsigned long *ptr = next_arg(args);
+            *ptr = (unsigned long)value;
+        } else if (size_modifier == 'L') {
+            // unsigned long long (ll modifier - using 'L' to represent)
+            unsigned long long *ptr = next_arg(args);
+            *ptr = value;
+        } else {
+            // regular unsigned int (default)
+            unsigned int *ptr = next_arg(args);
+            *ptr = (unsigned int)value;
+        }
+    }
+    return 1;
+}
+
+// Value of every digit character in bases up to 16, 0xFF for everything else
+// One lookup instead of range checks per character, a character is a digit in
+// base b when its value is below b
+static const unsigned char digit_value[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+       0,    1,    2,    3,    4,    5,    6,    7,    8,    9, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // '0' - '9'
+    0xFF,   10,   11,   12,   13,   14,   15, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 'A' - 'F'
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF,   10,   11,   12,   13,   14,   15, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 'a' - 'f'
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+// How many digits of each base always fit in 64 bits, numbers up to this long
+// never need the overflow check
+static const int safe_digits[17] = {0, 0, 64, 0, 0, 0, 0, 0, 21, 0, 19, 0, 0, 0, 0, 0, 16};
+
+// Converts 8 hex digits (already checked) into their 32 bit value all at once
+// Each byte becomes its nibble, then neighbouring nibbles are packed together
+// in 3 shift and mask steps instead of 8 multiply and add steps
+uint32_t pack_8_hex_digits(const char *digits) {
+    uint64_t word;
+    memcpy(&word, digits, 8);
+
+    // '0'-'9' are 0x30-0x39, 'A'-'F' 0x41-0x46, 'a'-'f' 0x61-0x66: the low 4 bits
+    // are the value for digits, letters have bit 6 set and need 9 more
+    uint64_t letters = (word >> 6) & 0x0101010101010101ULL;
+    word = (word & 0x0F0F0F0F0F0F0F0FULL) + letters * 9;
+
+    // The first digit is in the lowest byte (little endian) and is the most significant
+    word = ((word & 0x000F000F000F000FULL) << 4) | ((word >> 8) & 0x000F000F000F000FULL);
+    word = ((word & 0x000000FF000000FFULL) << 8) | ((word >> 16) & 0x000000FF000000FFULL);
+    word = ((word & 0x000000000000FFFFULL) << 16) | (word >> 32);
+    return (uint32_t)word;
+}
+
+// Same idea for 8 decimal digits: pairs of digits become 0-99, pairs of those
+// 0-9999, then the two halves are put together with one multiply each
+uint32_t pack_8_decimal_digits(const char *digits) {
+    uint64_t word;
+    memcpy(&word, digits, 8);
+
+    word -= 0x3030303030303030ULL;
+    word = (word * 10) + (word >> 8);
+    word = (((word & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+            (((word >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return (uint32_t)word;
+}
+
+// And for 8 octal digits, 3 bits each so 24 bits in total
+uint32_t pack_8_octal_digits(const char *digits) {
+    uint64_t word;
+    memcpy(&word, digits, 8);
+
+    word &= 0x0707070707070707ULL;
+    word = ((word & 0x0007000700070007ULL) << 3) | ((word >> 8) & 0x0007000700070007ULL);
+    word = ((word & 0x0000003F0000003FULL) << 6) | ((word >> 16) & 0x0000003F0000003FULL);
+    word = ((word & 0x0000000000000FFFULL) << 12) | (word >> 32);
+    return (uint32_t)word;
+}
+
+// Mirrors the low 16 bits, bit 0 swaps with bit 15, bit 1 with bit 14 and so on
+unsigned reverse_16_bits(unsigned bits) {
+    bits = ((bits & 0x5555) << 1) | ((bits >> 1) & 0x5555);
+    bits = ((bits & 0x3333) << 2) | ((bits >> 2) & 0x3333);
+    bits = ((bits & 0x0F0F) << 4) | ((bits >> 4) & 0x0F0F);
+    bits = ((bits & 0x00FF) << 8) | ((bits >> 8) & 0x00FF);
+    return bits;
+}
+
+// Adds the run of binary digits at the start of bytes (at most n) onto the end of *value
+// Sets *overflow if a 1 gets pushed off the top of the 64 bits
+// Returns how many digits there were
+size_t fold_binary_digits(unsigned long long *value, const char *bytes, size_t n, int *overflow) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i one = _mm_set1_epi8('1');
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(bytes + i));
+        // Bit k of each mask is byte k of the chunk
+        unsigned ones = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, one));
+        unsigned zeros = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero));
+        unsigned not_binary = ~(ones | zeros) & 0xFFFF;
+        int run = not_binary != 0 ? lowest_set_bit(not_binary) : 16;
+
+        // The ones mask already is the value, just backwards: the first digit
+        // is bit 0 but it is the most significant. Mirror it and drop what's past the run
+        if (run > 0) {
+            *overflow |= (*value >> (64 - run)) != 0;
+            *value = (*value << run) | (reverse_16_bits(ones) >> (16 - run));
+        }
+        if (run < 16) {
+            return i + run;
+        }
+    }
+#endif
+
+    // Whatever is left over (everything without SSE2) one digit at a time
+    for (; i < n && (bytes[i] == '0' || bytes[i] == '1'); i++) {
+        *overflow |= (*value >> 63) != 0;
+        *value = *value * 2 + (bytes[i] - '0');
+    }
+    return i;
+}
+
+// Adds the run of digits at the start of bytes (at most n) onto the end of *value,
+// 8 digits per step for bases 8, 10 and 16 and 16 per step for base 2
+// Sets *overflow when the number stops fitting in 64 bits
+// Returns how many digits there were
+size_t fold_digits(unsigned long long *value, const char *bytes, size_t n, int base, int *overflow) {
+    if (base == 2) {
+        return fold_binary_digits(value, bytes, n, overflow);
+    }
+
+    // Measure the run first so the packing below never has to check a digit
+    size_t count = 0;
+    while (count < n && digit_value[(unsigned char)bytes[count]] < base) {
+        count++;
+    }
+
+    size_t i = 0;
+    unsigned long long v = *value;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; i + 8 <= count; i += 8) {
+        // Digits past what fits push the oldest ones off the top, same as value * base each time
+        if (base == 16) {
+            *overflow |= (v >> 32) != 0;
+            v = (v << 32) | pack_8_hex_digits(bytes + i);
+        } else if (base == 8) {
+            *overflow |= (v >> 40) != 0;
+            v = (v << 24) | pack_8_octal_digits(bytes + i);
+        } else {
+            // Anything below ULLONG_MAX / 10^8 can't overflow, only check above that
+            if (v >= 184467440737ULL) {
+                *overflow |= mul_add_overflows(&v, 100000000, pack_8_decimal_digits(bytes + i));
+            } else {
+                v = v * 100000000 + pack_8_decimal_digits(bytes + i);
+            }
+        }
+    }
+#endif
+
+    // Whatever is left over one digit at a time
+    for (; i < count; i++) {
+        *overflow |= mul_add_overflows(&v, base, digit_value[(unsigned char)bytes[i]]);
+    }
+
+    *value = v;
+    return count;
+}
+
+// The digit kernel every integer conversion shares
+// c is the first character (already read), reads digits of base until a non digit
+// (which is put back) or width_left digits (0 means unlimited)
+// Returns how many digits were read
+int read_digits(scan_input *in, int c, int base, int width_left, unsigned long long *value, int *overflow) {
+    int count = 0;
+
+    if (in->stream == NULL) {
+        // Reading from a window: convert whole runs of digits at a time
+        unread_char(in, c);
+
+        size_t available;
+        while ((available = window_available(in)) > 0) {
+            // Don't look past the width limit
+            if (width_left > 0 && available > (size_t)(width_left - count)) {
+                available = width_left - count;
+            }
+
+            size_t run = fold_digits(value, in->data + in->pos, available, base, overflow);
+            count += run;
+            in->pos += run;
+
+            // Stop at the first non digit or the width limit,
+            // otherwise the digits go on past the end of the window
+            if (run < available || (width_left > 0 && count >= width_left)) {
+                break;
+            }
+        }
+        return count;
+    }
+
+    while (c != EOF && digit_value[c] < base) {
+        // Convert string numbers to values
+        // Short numbers always fit in 64 bits, only longer ones need the overflow check
+        if (count < safe_digits[base]) {
+            *value = *value * base + digit_value[c];
+        } else {
+            *overflow |= mul_add_overflows(value, base, digit_value[c]);
+        }
+        count++;
+
+        // Check width limit after each digit read in, unless width is 0 ie unlimited
+        // The digit was used so there is nothing to put back
+        if (width_left > 0 && count >= width_left) {
+            return count;
+        }
+
+        c = next_char(in);
+    }
+
+    // Put back the non-digit character we just read (if not EOF)
+    unread_char(in, c);
+    return count;
+}
+
+#ifdef __SIZEOF_INT128__
+// Digits for the w128 conversions, the value has two 64 bit limbs
+// The low limb is read with the normal kernel (so ids that fit in 64 bits cost the
+// same as %lld), only numbers longer than that carry on into the 128 bit loop
+int read_wide_digits(scan_input *in, int c, int base, int width_left, unsigned __int128 *value, int *overflow) {
+    unsigned long long low = 0;
+    int low_overflow = 0;
+
+    // Never more digits than always fit in the low limb
+    int limit = safe_digits[base];
+    if (width_left > 0 && width_left < limit) {
+        limit = width_left;
+    }
+
+    int count = read_digits(in, c, base, limit, &low, &low_overflow);
+    *value = low;
+
+    // Stopped at a non digit (already put back) or the width limit
+    if (count < limit || (width_left > 0 && count >= width_left)) {
+        return count;
+    }
+
+    // Still more digits, keep going in 128 bits
+    c = next_char(in);
+    while (c != EOF && digit_value[c] < base) {
+        *overflow |= __builtin_mul_overflow(*value, (unsigned)base, value);
+        *overflow |= __builtin_add_overflow(*value, (unsigned)digit_value[c], value);
+        count++;
+
+        if (width_left > 0 && count >= width_left) {
+            return count;
+        }
+        c = next_char(in);
+    }
+
+    unread_char(in, c);
+    return count;
+}
+
+// Same as store_signed and store_unsigned for __int128 and unsigned __int128
+int store_wide(scan_args *args, int suppress, int is_signed, int negative, unsigned __int128 magnitude, int overflow) {
+    unsigned __int128 max = ~(unsigned __int128)0;
+    if (is_signed) {
+        max >>= 1;
+    }
+    // One more on the negative side for the signed conversions
+    unsigned __int128 limit = (is_signed && negative) ? max + 1 : max;
+
+    if (overflow || magnitude > limit) {
+        overflow_count++;
+        if (overflow_policy == MY_SCAN_OVERFLOW_FAIL) {
+            return 0;
+        }
+        if (overflow_policy == MY_SCAN_OVERFLOW_SATURATE) {
+            magnitude = limit;
+            // Saturating an unsigned conversion gives the largest value, not its negation
+            if (!is_signed) {
+                negative = 0;
+            }
+        }
+    }
+
+    // Unsigned math so wrapping is well defined, a minus sign on an unsigned conversion wraps like strtoul
+    unsigned __int128 value = negative ? 0 - magnitude : magnitude;
+
+    if (!suppress) {
+        if (is_signed) {
+            __int128 *ptr = next_arg(args);
+            *ptr = (__int128)value;
+        } else {
+            unsigned __int128 *ptr = next_arg(args);
+            *ptr = value;
+        }
+    }
+    return 1;
+}
+#endif
+
+// Every integer conversion: %d and %i are signed, %u %o %x %b unsigned
+// %x and %b take no sign at all like before, %u and %o wrap a negative number like scanf
+// base 0 (%i) works the base out from the prefix like strtol: 0x hex, 0b binary,
+// a leading 0 octal and otherwise decimal
+int read_number(scan_input *in, scan_args *args, int width, char size_modifier, int suppress, int base, int is_signed) {
+    int c;
+    int negative = 0;
+    unsigned long long value = 0;
+    int overflow = 0;
+    int digit_count = 0;
+    int chars_read = 0;
+
+    // Consume all leading whitespace
+    c = skip_whitespace(in);
+
+    if (c == EOF) {
+        return 0;  // Failed to read anything
+    }
+
+    // Check for optional sign
+    if ((c == '+' || c == '-') && base != 16 && base != 2) {
+        if (c == '-') {
+            negative = 1;
+        }
+        chars_read++;
+
+        // Check if we've hit width limit after just the sign
+        // Don't check if the width limit is set to 0 ie unlimited
+        if (width > 0 && chars_read >= width) {
+            return 0;  // No digits read, just a sign
+        }
+        // We can still read in more digits, go to the next one
+        c = next_char(in);
+    }
+
+    // Handle 0x or 0b prefix (optional for %x and %b, picks the base for %i)
+    if (c == '0' && (base == 0 || base == 16 || base == 2)) {
+        chars_read++;
+
+        // Check if we've hit width limit after just the '0'
+        if (width > 0 && chars_read >= width) {
+            // Just read a 0 without x, treat it as a digit
+            digit_count = 1;
+        } else {
+            // We can still read more, check for the letter
+            // It's only a prefix if a digit follows, so remember where it started
+            size_t mark = checkpoint(in);
+            int next = next_char(in);
+            int hex_prefix = (next == 'x' || next == 'X') && (base == 0 || base == 16);
+            int binary_prefix = (next == 'b' || next == 'B') && (base == 0 || base == 2);
+            int prefix_base = hex_prefix ? 16 : (binary_prefix ? 2 : 0);
+
+            if (prefix_base != 0) {
+                // prefix found, this counts toward width but not as a digit
+                chars_read++;
+
+                // Check width limit after the prefix
+                if (width > 0 && chars_read >= width) {
+                    release_checkpoint(in);
+                    return 0;  // No digits read, just the prefix
+                }
+
+                // Continue with reading digits
+                c = next_char(in);
+                if (c == EOF || digit_value[c] >= prefix_base) {
+                    // Like strtol "0x" followed by anything else is the number 0,
+                    // the x goes back to the input for whatever comes next
+                    chars_read--;
+                    prefix_base = 0;
+                }
+            }
+
+            if (prefix_base != 0) {
+                release_checkpoint(in);
+                base = prefix_base;
+            } else {
+                // Just a leading 0, it was a digit
+                rollback(in, mark);
+                digit_count = 1;
+                // For %i a leading 0 means octal
+                if (base == 0) {
+                    base = 8;
+                }
+                c = next_char(in);
+            }
+        }
+    }
+
+    // No prefix for %i means decimal
+    if (base == 0) {
+        base = 10;
+    }
+
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 wide = 0;
+#endif
+
+    if (width > 0 && chars_read >= width) {
+        // Width used up by the leading 0, it was the only digit and it's already
+        // consumed so nothing goes back to the input
+#ifdef __SIZEOF_INT128__
+    } else if (size_modifier == 'W') {
+        digit_count += read_wide_digits(in, c, base, width > 0 ? width - chars_read : 0, &wide, &overflow);
+#endif
+    } else {
+        digit_count += read_digits(in, c, base, width > 0 ? width - chars_read : 0, &value, &overflow);
+    }
+
+    // Check if we actually read any digits
+    if (digit_count == 0) {
+        return 0;  // Failed - no digits found
+    }
+
+#ifdef __SIZEOF_INT128__
+    if (size_modifier == 'W') {
+        return store_wide(args, suppress, is_signed, negative, wide, overflow);
+    }
+#endif
+
+    // Apply sign (optional), check the range and store the value
+    if (is_signed) {
+        return store_signed(args, size_modifier, suppress, negative, value, overflow);
+    }
+    return store_unsigned(args, size_modifier, suppress, negative, value, overflow);
+}
+
+// How %D handles digits past its precision, set per thread
+SCAN_THREAD_LOCAL my_scan_rounding rounding_policy = MY_SCAN_ROUND_TRUNCATE;
+
+void my_scan_set_rounding(my_scan_rounding rounding) {
+    rounding_policy = rounding;
+}
+
+// Powers of 10 that fit in 64 bits, for scaling %D values
+static const unsigned long long powers_of_10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// Fixed point decimal (%.4D): "123.4567" is stored as the integer 1234567, the number
+// scaled by 10^scale. Only integer math (the same digit kernel as %d) so it's exact
+// Digits past the scale are rounded by the rounding policy, stores a long long
+// unless there is a size modifier
+int read_fixed(scan_input *in, scan_args *args, int width, char size_modifier, int suppress, int scale) {
+    int c;
+    int negative = 0;
+    int chars_read = 0;
+    int overflow = 0;
+    unsigned long long int_part = 0;
+    unsigned long long frac_part = 0;
+    int int_digits = 0;
+    int frac_digits = 0;
+
+    // 10^19 is the most that fits, past that no value could be stored anyway
+    if (scale > 19) {
+        return 0;
+    }
+
+    // Consume all leading whitespace
+    c = skip_whitespace(in);
+
+    if (c == EOF) {
+        return 0;  // Failed to read anything
+    }
+
+    // Check for optional sign
+    if (c == '+' || c == '-') {
+        if (c == '-') {
+            negative = 1;
+        }
+        chars_read++;
+
+        if (width > 0 && chars_read >= width) {
+            return 0;  // No digits read, just a sign
+        }
+        c = next_char(in);
+    }
+
+    // Integer part, read_digits puts back whatever ends it
+    int_digits = read_digits(in, c, 10, width > 0 ? width - chars_read : 0, &int_part, &overflow);
+    chars_read += int_digits;
+    c = (width == 0 || chars_read < width) ? next_char(in) : EOF;
+
+    // Fractional part, only the first scale digits are part of the value
+    int round_digit = 0;   // first digit past the scale
+    int sticky = 0;        // any digit after that wasn't 0
+    if (c == '.' && (width == 0 || chars_read < width)) {
+        chars_read++;
+        c = (width == 0 || chars_read < width) ? next_char(in) : EOF;
+
+        if (scale > 0 && c != EOF) {
+            int limit = scale;
+            if (width > 0 && width - chars_read < limit) {
+                limit = width - chars_read;
+            }
+            frac_digits = read_digits(in, c, 10, limit, &frac_part, &overflow);
+            chars_read += frac_digits;
+            c = (frac_digits == scale && (width == 0 || chars_read < width)) ? next_char(in) : EOF;
+        }
+
+        // The digit that decides the rounding, then the rest just need to be skipped
+        if (c != EOF && isdigit(c)) {
+            round_digit = c - '0';
+            frac_digits++;
+            chars_read++;
+            c = (width == 0 || chars_read < width) ? next_char(in) : EOF;
+
+            if (c != EOF) {
+                unsigned long long rest = 0;
+                int rest_overflow = 0;
+                chars_read += read_digits(in, c, 10, width > 0 ? width - chars_read : 0, &rest, &rest_overflow);
+                sticky = rest != 0 || rest_overflow;
+                c = EOF;
+            }
+        }
+    }
+
+    // Put back the character that ended the number
+    if (c != EOF) {
+        unread_char(in, c);
+    }
+
+    // Needs a digit on at least one side of the point
+    if (int_digits == 0 && frac_digits == 0) {
+        return 0;
+    }
+
+    // value = int_part * 10^scale + the fraction padded out to scale digits
+    unsigned long long magnitude = 0;
+    if (int_part > ULLONG_MAX / powers_of_10[scale]) {
+        overflow = 1;
+    }
+    magnitude = int_part * powers_of_10[scale];
+
+    int fraction_used = frac_digits < scale ? frac_digits : scale;
+    unsigned long long fraction = frac_part * powers_of_10[scale - fraction_used];
+    overflow |= magnitude > ULLONG_MAX - fraction;
+    magnitude += fraction;
+
+    // Round on the digits that didn't fit
+    int round_up = 0;
+    if (rounding_policy == MY_SCAN_ROUND_HALF_UP) {
+        round_up = round_digit >= 5;
+    } else if (rounding_policy == MY_SCAN_ROUND_HALF_EVEN) {
+        round_up = round_digit > 5 || (round_digit == 5 && (sticky || (magnitude & 1)));
+    }
+    if (round_up) {
+        overflow |= magnitude == ULLONG_MAX;
+        magnitude++;
+    }
+
+    return store_signed(args, size_modifier != '\0' ? size_modifier : 'L', suppress, negative, magnitude, overflow);
+}
+
+// Multiplies value by 2^exponent, exact as long as the result stays in range
+// Done in steps so the powers of two themselves never overflow
+long double scale_by_power_of_2(long double value, int exponent) {
+    while (exponent > 60) {
+        value *= 0x1p60L;
+        exponent -= 60;
+    }
+    while (exponent < -60) {
+        value *= 0x1p-60L;
+        exponent += 60;
+    }
+    if (exponent >= 0) {
+        return value * (long double)(1ULL << exponent);
+    }
+    return value / (long double)(1ULL << -exponent);
+}
+
+// Rest of a hex float like 0x1.8p3 (%a), the 0x and any sign were already read
+// The digits are collected into an integer and the exponent is applied by scaling,
+// so there's no decimal rounding at all: the value is exact whenever it fits the variable
+int read_hex_float(scan_input *in, scan_args *args, int width, char size_modifier, int suppress, int negative, int chars_read) {
+    unsigned long long mantissa = 0;  // the first 64 significant bits
+    int exponent = 0;     // from digits that didn't fit in the mantissa or came after the point
+    int dropped = 0;      // some bits didn't fit
+    int round = 0;        // the first bit that didn't fit, needed to round correctly
+    int sticky = 0;       // any bit after it wasn't 0
+    int saw_digit = 0;
+    int in_fraction = 0;
+
+    int c = next_char(in);
+
+    // Hex digits on both sides of the point, 4 bits each
+    while (c != EOF && (width == 0 || chars_read < width)) {
+        if (c == '.' && !in_fraction) {
+            in_fraction = 1;
+        } else if (digit_value[c] < 16) {
+            unsigned digit = digit_value[c];
+            saw_digit = 1;
+
+            // As many of the digit's 4 bits as still fit in the mantissa
+            int room = 4;
+            while (room > 0 && (mantissa >> (64 - room)) != 0) {
+                room--;
+            }
+            if (room > 0) {
+                mantissa = (mantissa << room) | (digit >> (4 - room));
+            }
+            // The rest only count for their place and for rounding
+            for (int bit = 3 - room; bit >= 0; bit--) {
+                if (!dropped) {
+                    round = (digit >> bit) & 1;
+                    dropped = 1;
+                } else {
+                    sticky |= (digit >> bit) & 1;
+                }
+            }
+            exponent += in_fraction ? -room : 4 - room;
+        } else {
+            break;
+        }
+        chars_read++;
+
+        if (width > 0 && chars_read >= width) {
+            c = EOF;  // Width used up, nothing extra was read
+            break;
+        }
+        c = next_char(in);
+    }
+
+    // Binary exponent (optional), 'p' then decimal digits
+    if ((c == 'p' || c == 'P') && saw_digit && (width == 0 || chars_read < width)) {
+        int exp_sign = 1;
+        int power = 0;
+        int exp_digits = 0;
+        chars_read++;
+
+        // If no digits follow the p isn't part of the number, read it again from here
+        unread_char(in, c);
+        size_t mark = checkpoint(in);
+        next_char(in);
+        c = next_char(in);
+
+        // Exponent sign (optional)
+        if ((c == '+' || c == '-') && (width == 0 || chars_read < width)) {
+            if (c == '-') {
+                exp_sign = -1;
+            }
+            chars_read++;
+            c = next_char(in);
+        }
+
+        while (c != EOF && isdigit(c) && (width == 0 || chars_read < width)) {
+            // Anything this big is already infinity or 0, stop growing so it can't overflow
+            if (power < 100000) {
+                power = power * 10 + (c - '0');
+            }
+            exp_digits++;
+            chars_read++;
+
+            if (width > 0 && chars_read >= width) {
+                c = EOF;
+                break;
+            }
+            c = next_char(in);
+        }
+
+        // No digits after the p, same as for e the exponent isn't part of the number
+        if (exp_digits > 0) {
+            exponent += exp_sign * power;
+            release_checkpoint(in);
+        } else {
+            rollback(in, mark);
+            c = EOF;  // Everything from the p on is back in the input already
+        }
+    }
+
+    // Put back the character that ended the number
+    if (c != EOF) {
+        unread_char(in, c);
+    }
+
+    if (!saw_digit) {
+        return 0;
+    }
+
+#if LDBL_MANT_DIG >= 64
+    if (size_modifier == 'L') {
+        // long double takes all 64 bits, so round to nearest even here
+        if (round && (sticky || (mantissa & 1))) {
+            mantissa++;
+            if (mantissa == 0) {
+                mantissa = 1ULL << 63;  // Carried out of the top, 0xff..f rounds up to 0x10..0
+                exponent++;
+            }
+        }
+    } else
+#endif
+    if (round || sticky) {
+        // Far below float and double precision, the lowest bit only breaks ties
+        // when the cast to the variable's type rounds
+        mantissa |= 1;
+    }
+
+    // The mantissa fits a long double exactly and the scaling is exact,
+    // so the only rounding is the one cast to the variable's type
+    long double value = scale_by_power_of_2((long double)mantissa, exponent);
+    if (negative) {
+        value = -value;
+    }
+
+    if (!suppress) {
+        if (size_modifier == 'l') {
+            double *ptr = next_arg(args);
+            *ptr = (double)value;
+        } else if (size_modifier == 'L') {
+            long double *ptr = next_arg(args);
+            *ptr = value;
+        } else {
+            float *ptr = next_arg(args);
+            *ptr = (float)value;
+        }
+    }
+    return 1;
+}
+
+// Adds one accepted character to the copy %Lf converts at the end
+// If the copy can't grow *exact is cleared and the double result is used instead
+void keep_float_char(text_output *text, int *exact, int c) {
+    if (*exact && !put_char(text, (char)c)) {
+        *exact = 0;
+    }
+}
+
+int read_float(scan_input *in, scan_args *args, int width, char size_modifier, int suppress) {
+    int c;
+    int chars_read = 0;
+    int sign = 1;
+
+    double int_part = 0.0;
+    double frac_part = 0.0;
+    double frac_divisor = 1.0;
+
+    int saw_digit = 0;
+    int saw_fraction = 0;
+    int saw_exponent = 0;
+
+    int exp_sign = 1;
+    int exponent = 0;
+
+    // %Lf keeps a copy of the number and converts it with strtold at the end, the
+    // double math below would throw away the extra precision of a long double
+    text_output text;
+    int keep = size_modifier == 'L' && !suppress;
+    int exact = keep;
+    if (keep) {
+        start_allocated_text(&text, NULL);
+    }
+
+    // Consume all leading whitespace
+    c = skip_whitespace(in);
+
+    if (c == EOF) {
+        if (keep) {
+            discard_text(&text);
+        }
+        return 0;  // Failed to read anything
+    }
+
+    // Check for optional sign
+    if (c == '+' || c == '-') {
+        if (c == '-') {
+            sign = -1;
+        }
+        keep_float_char(&text, &exact, c);
+        chars_read++;
+
+        // Check if we've hit width limit after just the sign
+        // Don't check if the width limit is 0 ie unlimited
+        if (width > 0 && chars_read >= width) {
+            if (keep) {
+                discard_text(&text);
+            }
+            return 0;  // No digits read, just a sign
+        }
+        // We can still read in more digits, go to the next one
+        c = next_char(in);
+    }
+
+    // Hex float, for %a but like strtod every float conversion takes them
+    // "0x" without hex digits after it is only a 0, then the x goes back to the input
+    if (c == '0' && (width == 0 || chars_read + 1 < width)) {
+        size_t mark = checkpoint(in);
+        int next = next_char(in);
+        if ((next == 'x' || next == 'X') &&
+            read_hex_float(in, args, width, size_modifier, suppress, sign < 0, chars_read + 2)) {
+            release_checkpoint(in);
+            if (keep) {
+                discard_text(&text);
+            }
+            return 1;
+        }
+        rollback(in, mark);
+    }
+
+    // Integer part before the decimal point, same as in %d
+    while (c != EOF && isdigit(c)) {
+        saw_digit = 1;
+        int_part = int_part * 10.0 + (c - '0');
+        keep_float_char(&text, &exact, c);
+        chars_read++;
+
+        if (width > 0 && chars_read >= width) {
+            break;
+        }
+
+        c = next_char(in);
+    }
+
+    //  Fractional part after decimal point
+    if (c == '.' && (width == 0 || chars_read < width)) {
+        saw_fraction = 1;
+        keep_float_char(&text, &exact, c);
+        chars_read++;
+
+        c = next_char(in);
+
+        while (c != EOF && isdigit(c) && (width == 0 || chars_read < width)) {
+            saw_digit = 1;
+            // Same conversion logic as %d
+            frac_part = frac_part * 10.0 + (c - '0');
+            // Divisor is basically the tenth, hundredth, etc. place
+            frac_divisor *= 10.0;
+            keep_float_char(&text, &exact, c);
+            chars_read++;
+
+            if (width > 0 && chars_read >= width) break;
+
+            c = next_char(in);
+        }
+    }
+
+    // Exponent part (optional)
+    if ((c == 'e' || c == 'E') && (width == 0 || chars_read < width)) {
+        saw_exponent = 1;
+        // Where the copy goes back to if the exponent turns out to have no digits
+        size_t before_exponent = exact ? text.length : 0;
+        keep_float_char(&text, &exact, c);
+        chars_read++;
+
+        // Same for the input, "5e+x" is the number 5 followed by "e+x"
+        unread_char(in, c);
+        size_t mark = checkpoint(in);
+        next_char(in);
+        c = next_char(in);
+
+        // Exponent sign (optional)
+        if (c == '+' || c == '-') {
+            if (c == '-') {
+                exp_sign = -1;
+            }
+            keep_float_char(&text, &exact, c);
+            chars_read++;
+            c = next_char(in);
+        }
+
+        // Calculate exponent digits
+        int exp_digits = 0;
+        while (c != EOF && isdigit(c) && (width == 0 || chars_read < width)) {
+            exponent = exponent * 10 + (c - '0');
+            keep_float_char(&text, &exact, c);
+            exp_digits++;
+            chars_read++;
+
+            // Stop if you reach the width maximum
+            if (width > 0 && chars_read >= width) {
+                break;
+            }
+
+            c = next_char(in);
+        }
+        if (exp_digits > 0) {
+            release_checkpoint(in);
+        }
+        // No digits after the e for exponentiation
+        if (exp_digits == 0) {
+            // Give back the e, the sign and whatever ended them
+            rollback(in, mark);
+            c = EOF;
+            // Ignore exponent entirely, only calculate digits preceding e
+            exponent = 0;
+            saw_exponent = 0;
+            if (exact) {
+                text.length = before_exponent;
+            }
+        }
+    }
+
+    // Put back extra character if it is NOT part of the float
+    if (c != EOF && !isspace(c)) {
+        // These are valid characters in a float that are not numeric
+        if (!isdigit(c) && c != '.' && c != 'e' && c != 'E' && c != '+' && c != '-') {
+            unread_char(in, c);
+        }
+    }
+
+    // No digits were read at all
+    if (!saw_digit) {
+        if (keep) {
+            discard_text(&text);
+        }
+        return 0;
+    }
+
+    // Calculate final float based on exponents and fractions
+    double value = int_part;
+
+    // Add the 'fraction' that goes after the decimal point
+    if (saw_fraction) {
+        value += frac_part / frac_divisor;
+    }
+
+    // Add optional sign
+    value *= sign;
+
+    // Exponent math
+    if (saw_exponent && exponent != 0) {
+        double pow10 = 1.0;
+        // exponent of 1 if just * 10, 2 is * 100, 3 is *1000, etc
+        for (int i = 0; i < exponent; i++) {
+            pow10 *= 10.0;
+        }
+        // negative exponent moves decimal point to the left, positive moves to the right
+        if (exp_sign == -1)
+            value /= pow10;
+        else
+            value *= pow10;
+    }
+
+    // Store based on size modifier
+    if (!suppress) {
+        if (size_modifier == 'l') {
+            double *ptr = next_arg(args);
+            *ptr = value;
+        } else if (size_modifier == 'L') {
+            long double *ptr = next_arg(args);
+            // The copy is only scratch, terminate it in place rather than going
+            // through finish_text, which would log it as a %m result for the caller
+            if (exact && put_char(&text, '\0')) {
+                *ptr = strtold(text.dest, NULL);
+            } else {
+                // Couldn't keep the copy, the double result is the best we have
+                *ptr = (long double)value;
+            }
+            discard_text(&text);
+        } else {
+            float *ptr = next_arg(args);
+            *ptr = (float)value;
+        }
+    }
+    return 1;
+}
+
+// Hex text decoded straight into bytes (%U), for UUIDs and digests
+// The width is the number of bytes (16 when not given, the size of a UUID) and the
+// argument is an unsigned char array that big. A single '-' is allowed between any two
+// bytes so 123e4567-e89b-12d3-a456-426614174000 works as well as the plain digits
+// From a window, runs of 8 digits become 4 bytes at once with the same packing as %x
+int read_hex_bytes(scan_input *in, scan_args *args, int width, int suppress) {
+    size_t count = width > 0 ? (size_t)width : 16;
+    unsigned char *bytes = suppress ? NULL : next_arg(args);
+    size_t done = 0;
+    int hyphen_allowed = 0;
+
+    int c = skip_whitespace(in);
+    if (c == EOF) {
+        return 0;  // Failed to read anything
+    }
+    unread_char(in, c);
+
+    while (done < count) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        // Whole groups of 8 digits straight out of the window
+        if (in->stream == NULL && count - done >= 4 && window_available(in) >= 8) {
+            const char *digits = in->data + in->pos;
+            int all_hex = 1;
+            for (int i = 0; i < 8; i++) {
+                all_hex &= digit_value[(unsigned char)digits[i]] < 16;
+            }
+            if (all_hex) {
+                uint32_t value = pack_8_hex_digits(digits);
+                if (bytes != NULL) {
+                    bytes[done] = (unsigned char)(value >> 24);
+                    bytes[done + 1] = (unsigned char)(value >> 16);
+                    bytes[done + 2] = (unsigned char)(value >> 8);
+                    bytes[done + 3] = (unsigned char)value;
+                }
+                in->pos += 8;
+                done += 4;
+                hyphen_allowed = 1;
+                continue;
+            }
+        }
+#endif
+
+        // One byte (or a hyphen) at a time
+        c = next_char(in);
+        if (c == '-' && hyphen_allowed) {
+            hyphen_allowed = 0;
+            continue;
+        }
+        if (c == EOF || digit_value[c] > 15) {
+            unread_char(in, c);
+            return 0;  // Fewer digits than bytes asked for
+        }
+        int low = next_char(in);
+        if (low == EOF || digit_value[low] > 15) {
+            unread_char(in, low);
+            return 0;  // Odd number of digits
+        }
+        if (bytes != NULL) {
+            bytes[done] = (unsigned char)(digit_value[c] << 4 | digit_value[low]);
+        }
+        done++;
+        hyphen_allowed = 1;
+    }
+
+    return 1;
+}
+
+// How %Z treats the '=' padding, set per thread
+SCAN_THREAD_LOCAL my_scan_base64 base64_mode = MY_SCAN_BASE64_LENIENT;
+
+void my_scan_set_base64(my_scan_base64 mode) {
+    base64_mode = mode;
+}
+
+// Value of each base64 character (A-Z a-z 0-9 + /), 0xFF for everything else
+// Invalid characters have the top bit set so a whole block can be checked with one OR
+static const unsigned char base64_value[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,   62, 0xFF, 0xFF, 0xFF,   63,  // '+' '/'
+      52,   53,   54,   55,   56,   57,   58,   59,   60,   61, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // '0' - '9'
+    0xFF,    0,    1,    2,    3,    4,    5,    6,    7,    8,    9,   10,   11,   12,   13,   14,  // 'A' - 'O'
+      15,   16,   17,   18,   19,   20,   21,   22,   23,   24,   25, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 'P' - 'Z'
+    0xFF,   26,   27,   28,   29,   30,   31,   32,   33,   34,   35,   36,   37,   38,   39,   40,  // 'a' - 'o'
+      41,   42,   43,   44,   45,   46,   47,   48,   49,   50,   51, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 'p' - 'z'
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+// Base64 decoded straight into the caller's buffer (%Z) or new storage (%mZ)
+// Takes two arguments: the unsigned char* buffer (unsigned char** for %mZ) and a size_t*
+// that gets the number of bytes decoded. The width limits the characters read, padding included
+// From a window, 8 characters become 6 bytes per step with a single validity check
+int read_base64(scan_input *in, scan_args *args, int width, int suppress, int allocate) {
+    char **result = NULL;
+    size_t *length = NULL;
+    text_output out;
+
+    if (!suppress) {
+        if (allocate) {
+            result = next_arg(args);
+            start_allocated_text(&out, current_arena);
+        } else {
+            start_text(&out, next_arg(args));
+        }
+        length = next_arg(args);
+    }
+
+    int c = skip_whitespace(in);
+    if (c == EOF) {
+        if (!suppress) {
+            discard_text(&out);
+        }
+        return 0;  // Failed to read anything
+    }
+    unread_char(in, c);
+
+    int chars_read = 0;
+    unsigned long long bits = 0;  // characters of the current group of 4
+    int pending = 0;
+    char decoded[6];
+
+    // Whole blocks of 8 characters straight out of the window
+    if (in->stream == NULL) {
+        while ((width == 0 || chars_read + 8 <= width) && window_available(in) >= 8) {
+            const unsigned char *block = (const unsigned char *)in->data + in->pos;
+            unsigned long long value = 0;
+            unsigned invalid = 0;
+            for (int i = 0; i < 8; i++) {
+                invalid |= base64_value[block[i]];
+                value = (value << 6) | base64_value[block[i]];
+            }
+            if (invalid & 0x80) {
+                break;  // The end of the field is in this block
+            }
+            for (int i = 0; i < 6; i++) {
+                decoded[i] = (char)(value >> (40 - 8 * i));
+            }
+            if (!suppress && !put_chars(&out, decoded, 6)) {
+                discard_text(&out);
+                return 0;  // Out of memory for %mZ
+            }
+            in->pos += 8;
+            chars_read += 8;
+        }
+    }
+
+    // The rest one character at a time, 4 characters are 3 bytes
+    while (width == 0 || chars_read < width) {
+        c = next_char(in);
+        if (c == EOF || base64_value[c] > 63) {
+            unread_char(in, c);
+            break;
+        }
+        bits = (bits << 6) | base64_value[c];
+        chars_read++;
+
+        if (++pending == 4) {
+            decoded[0] = (char)(bits >> 16);
+            decoded[1] = (char)(bits >> 8);
+            decoded[2] = (char)bits;
+            if (!suppress && !put_chars(&out, decoded, 3)) {
+                discard_text(&out);
+                return 0;  // Out of memory for %mZ
+            }
+            bits = 0;
+            pending = 0;
+        }
+    }
+
+    // A partial group at the end: 2 characters are 1 byte and 3 are 2 bytes,
+    // padded with "==" or "=". Strict mode wants the padding and the unused bits 0
+    int padding = 0;
+    if (pending == 1) {
+        if (!suppress) {
+            discard_text(&out);
+        }
+        return 0;  // One character can't make a byte
+    }
+    if (pending > 1) {
+        int expected = 4 - pending;
+        while (padding < expected && (width == 0 || chars_read < width)) {
+            c = next_char(in);
+            if (c != '=') {
+                unread_char(in, c);
+                break;
+            }
+            padding++;
+            chars_read++;
+        }
+
+        int unused_bits = pending == 2 ? 4 : 2;
+        if (base64_mode == MY_SCAN_BASE64_STRICT &&
+            (padding != expected || (bits & ((1u << unused_bits) - 1)) != 0)) {
+            if (!suppress) {
+                discard_text(&out);
+            }
+            return 0;
+        }
+
+        bits >>= unused_bits;
+        if (pending == 3) {
+            decoded[0] = (char)(bits >> 8);
+            decoded[1] = (char)bits;
+        } else {
+            decoded[0] = (char)bits;
+        }
+        if (!suppress && !put_chars(&out, decoded, pending - 1)) {
+            discard_text(&out);
+            return 0;  // Out of memory for %mZ
+        }
+    }
+
+    if (chars_read == 0) {
+        if (!suppress) {
+            discard_text(&out);
+        }
+        return 0;
+    }
+
+    if (!suppress) {
+        if (!finish_text(&out, result, 0)) {
+            discard_text(&out);
+            return 0;
+        }
+        *length = out.length;
+    }
+    return 1;
+}
+
+int read_char(scan_input *in, scan_args *args, int width, int suppress, int allocate) {
+    if (width == 0) {
+        width = 1;  // Default read 1 character
+    }
+
+    char **result = NULL;
+    text_output out;
+    // get the address where the character(s) will be stored
+    // for %mc it's the address of a char* that will point at the storage we allocate
+    if (!suppress) {
+        if (allocate) {
+            result = next_arg(args);
+            start_allocated_text(&out, current_arena);
+        } else {
+            start_text(&out, next_arg(args));
+        }
+    }
+
+    int chars_read = 0;
+
+    if (in->stream == NULL) {
+        // Reading from a window: copy as much as the window has in one go,
+        // and when suppressed just move past it without looking at it
+        size_t available;
+        while (chars_read < width && (available = window_available(in)) > 0) {
+            if (available > (size_t)(width - chars_read)) {
+                available = width - chars_read;
+            }
+            if (!suppress && !put_chars(&out, in->data + in->pos, available)) {
+                discard_text(&out);
+                return 0;  // Out of memory for %mc
+            }
+            in->pos += available;
+            chars_read += available;
+        }
+    } else {
+        // Read exactly 'width' characters (or until EOF)
+        for (int i = 0; i < width; i++) {
+            int c = next_char(in);
+
+            if (c == EOF) {
+                // If we hit EOF before reading all requested chars,
+                // scanf fails and returns the count so far
+                break;
+            }
+
+            if (!suppress && !put_char(&out, (char)c)) {
+                discard_text(&out);
+                return 0;  // Out of memory for %mc
+            }
+            chars_read++;
+        }
+    }
+
+    if (chars_read == 0) {
+        if (!suppress) {
+            discard_text(&out);
+        }
+        return 0;
+    }
+
+    // %c does not null-terminate
+    if (!suppress && !finish_text(&out, result, 0)) {
+        discard_text(&out);
+        return 0;
+    }
+
+    // Return 1 if we read at least 1 character, 0 otherwise
+    return 1;
+}
+
+int read_string(scan_input *in, scan_args *args, int width, int suppress, int allocate, int intern) {
+    int c;
+    int chars_read = 0;
+
+    // %ks needs a table to intern into
+    if (intern && !suppress && current_intern == NULL) {
+        return 0;
+    }
+
+    // Consume all leading whitespace
+    c = skip_whitespace(in);
+
+    if (c == EOF) {
+        return 0;  // Failed to read anything
+    }
+
+    // Get the pointer where we should store the result
+    // Only get it if we're not suppressing assignment
+    // For %ks it's the address of a const char* that will point at the interned copy
+    char **result = NULL;
+    text_output out;
+    if (!suppress) {
+        if (intern) {
+            result = next_arg(args);
+            start_interned_text(&out, current_intern);
+        } else if (allocate) {
+            result = next_arg(args);
+            start_allocated_text(&out, current_arena);
+        } else {
+            start_text(&out, next_arg(args));
+        }
+    }
+
+    if (in->stream == NULL) {
+        // Reading from a window: find where the token ends 16 bytes at a time
+        // and copy it in one go instead of testing and storing every character
+        unread_char(in, c);
+
+        size_t available;
+        while ((available = window_available(in)) > 0) {
+            const char *start = in->data + in->pos;
+
+            // Don't look past the width limit
+            if (width > 0 && available > (size_t)(width - chars_read)) {
+                available = width - chars_read;
+            }
+
+            size_t count = find_space(in, start, available);
+            if (!suppress && !put_chars(&out, start, count)) {
+                discard_text(&out);
+                return 0;  // Out of memory for %ms
+            }
+            chars_read += count;
+            in->pos += count;
+
+            // Stop at the whitespace (left in the input) or the width limit,
+            // otherwise the token goes on past the end of the window
+            if (count < available || (width > 0 && chars_read >= width)) {
+                break;
+            }
+        }
+    } else {
+        // Read non-whitespace characters
+        while (c != EOF && !isspace(c)) {
+            // Store the character if not suppressing
+            if (!suppress && !put_char(&out, (char)c)) {
+                discard_text(&out);
+                return 0;  // Out of memory for %ms
+            }
+            chars_read++;
+
+            // Check width limit after each character read in, unless width is 0 ie unlimited
+            if (width > 0 && chars_read >= width) {
+                break;
+            }
+
+            c = next_char(in);
+        }
+
+        // Put back the whitespace character we just read (if not EOF)
+        // If we stopped because of the width, c was stored so there is nothing to put back
+        if (c != EOF && isspace(c)) {
+            unread_char(in, c);
+        }
+    }
+
+    // The push parser ran out of input in the middle of the token, it's read again in
+    // full once the rest is fed in. Don't intern the piece we have, it'd stay in the table
+    if (intern && in->starved) {
+        if (!suppress) {
+            discard_text(&out);
+        }
+        return 0;
+    }
+
+    // Check if we actually read any characters
+    if (chars_read == 0) {
+        if (!suppress) {
+            discard_text(&out);
+        }
+        return 0;  // Failed - no characters found
+    }
+
+    // Null-terminate the string if not suppressed
+    if (!suppress && !finish_text(&out, result, 1)) {
+        discard_text(&out);
+        return 0;
+    }
+
+    return 1;  // Successfully read 1 item
+}
+
+int read_boolean(scan_input *in, scan_args *args, int width, int suppress) {
+    int c;
+    int chars_read = 0;
+    int bool_value = -1;  // -1 means undetermined
+
+    // Consume all leading whitespace
+    c = skip_whitespace(in);
+
+    if (c == EOF) {
+        return 0;  // Failed to read anything
+    }
+
+    // Convert first character to lowercase for comparison
+    int first_char = tolower(c);
+    chars_read++;
+
+    if (first_char == '1') {
+        bool_value = 1;
+    } else if (first_char == '0') {
+        bool_value = 0;
+    } else if (first_char == 't' || first_char == 'y') {
+        // Might be "true" or "yes", but accept just "t" or "y"
+        bool_value = 1;
+
+        // Try to read more characters if width allows
+        if (width == 0 || chars_read < width) {
+            // Peek at next character to see if it continues the word
+            int next = next_char(in);
+            if (next != EOF) {
+                int next_lower = tolower(next);
+                // Check if it's part of "true" or "yes"
+                if ((first_char == 't' && next_lower == 'r') ||
+                    (first_char == 'y' && next_lower == 'e')) {
+                    // Continue reading the rest of the word
+                    chars_read++;
+                    while ((width == 0 || chars_read < width)) {
+                        next = next_char(in);
+                        if (next == EOF || isspace(next) || !isalpha(next)) {
+                            if (next != EOF) {
+                                unread_char(in, next);
+                            }
+                            break;
+                        }
+                        chars_read++;
+                    }
+                } else {
+                    // Not part of a boolean word, put it back
+                    unread_char(in, next);
+                }
+            }
+        }
+    } else if (first_char == 'f' || first_char == 'n') {
+        // Might be "false" or "no", but accept just "f" or "n"
+        bool_value = 0;
+
+        // Try to read more characters if width allows
+        if (width == 0 || chars_read < width) {
+            int next = next_char(in);
+            if (next != EOF) {
+                int next_lower = tolower(next);
+                if ((first_char == 'f' && next_lower == 'a') ||
+                    (first_char == 'n' && next_lower == 'o')) {
+                    // Continue reading the rest of the word
+                    chars_read++;
+                    while ((width == 0 || chars_read < width)) {
+                        next = next_char(in);
+                        if (next == EOF || isspace(next) || !isalpha(next)) {
+                            if (next != EOF) {
+                                unread_char(in, next);
+                            }
+                            break;
+                        }
+                        chars_read++;
+                    }
+                } else {
+                    unread_char(in, next);
+                }
+            }
+        }
+    } else {
+        // Unrecognized boolean format
+        unread_char(in, c);
+        return 0;
+    }
+
+    // Store the boolean value (if not suppressed)
+    if (!suppress) {
+        int *ptr = next_arg(args);
+        *ptr = bool_value;
+    }
+
+    return 1;
+}
+
+int read_line(scan_input *in, scan_args *args, int width, int suppress, int allocate) {
+    int c;
+    int chars_read = 0;
+
+    // NOTE: Unlike %s, this does NOT skip leading whitespace
+    // It reads everything up to (but not including) the newline
+
+    // Get the pointer where we should store the result
+    char **result = NULL;
+    text_output out;
+    if (!suppress) {
+        if (allocate) {
+            result = next_arg(args);
+            start_allocated_text(&out, current_arena);
+        } else {
+            start_text(&out, next_arg(args));
+        }
+    }
+
+    if (in->stream == NULL) {
+        // Reading from a window: find the newline with memchr and copy everything
+        // before it in one go instead of a character at a time
+        size_t available;
+        c = EOF;
+        while ((available = window_available(in)) > 0) {
+            const char *start = in->data + in->pos;
+
+            // Don't look past the width limit
+            if (width > 0 && available > (size_t)(width - chars_read)) {
+                available = width - chars_read;
+            }
+
+            const char *newline = memchr(start, '\n', available);
+            size_t count = newline != NULL ? (size_t)(newline - start) : available;
+
+            if (!suppress && !put_chars(&out, start, count)) {
+                discard_text(&out);
+                return 0;  // Out of memory for %mN
+            }
+            chars_read += count;
+            in->pos += count;
+
+            if (newline != NULL) {
+                // The newline is consumed but not stored
+                in->pos++;
+                c = '\n';
+                break;
+            }
+            if (width > 0 && chars_read >= width) {
+                c = 0;  // stopped by the width, not EOF
+                break;
+            }
+            // Line continues past the end of the window, refill and keep looking
+        }
+    } else {
+        // Read characters until newline or EOF
+        while ((c = next_char(in)) != EOF && c != '\n') {
+            // Store the character if not suppressing
+            if (!suppress && !put_char(&out, (char)c)) {
+                discard_text(&out);
+                return 0;  // Out of memory for %mN
+            }
+            chars_read++;
+
+            // Check width limit after each character read in, unless width is 0 ie unlimited
+            if (width > 0 && chars_read >= width) {
+                break;
+            }
+        }
+    }
+
+    // The newline terminates the line and IS consumed by the read
+    // If we stopped because of the width, the last character read was stored
+    // so there is nothing to put back
+
+    // Return success if we read at least one character OR hit a newline
+    // (even an empty line should count as success)
+    if (chars_read == 0 && c != '\n') {
+        if (!suppress) {
+            // Plain buffers still get an empty string like before
+            if (!out.allocate) {
+                finish_text(&out, result, 1);
+            }
+            discard_text(&out);
+        }
+        return 0;
+    }
+
+    // Null-terminate the string if not suppressed
+    if (!suppress && !finish_text(&out, result, 1)) {
+        discard_text(&out);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Builds a dotted quad from bytes[0..n), dots has bit i set for each '.' at bytes[i]
+// Returns 0 unless it is exactly 4 numbers of 1 to 3 digits that are each at most 255
+// and have no leading zeros (01 could just as well be meant as octal)
+int parse_ipv4(const char *bytes, size_t n, unsigned dots, uint32_t *address) {
+    uint32_t value = 0;
+    size_t start = 0;
+
+    for (int part = 0; part < 4; part++) {
+        size_t end;
+        if (part < 3) {
+            if (dots == 0) {
+                return 0;  // Fewer than 3 dots
+            }
+            end = lowest_set_bit(dots);
+            dots &= dots - 1;
+        } else {
+            if (dots != 0) {
+                return 0;  // More than 3 dots
+            }
+            end = n;
+        }
+
+        if (end <= start || end - start > 3 || (end - start > 1 && bytes[start] == '0')) {
+            return 0;
+        }
+        unsigned octet = 0;
+        for (size_t i = start; i < end; i++) {
+            // The IPv6 tail gets here with any hex digits in it
+            if (!isdigit((unsigned char)bytes[i])) {
+                return 0;
+            }
+            octet = octet * 10 + (bytes[i] - '0');
+        }
+        if (octet > 255) {
+            return 0;
+        }
+        value = (value << 8) | octet;
+        start = end + 1;
+    }
+
+    *address = value;
+    return 1;
+}
+
+// Bit i set for each '.' in bytes[0..n), n is at most 16
+unsigned find_dots(const char *bytes, size_t n) {
+    unsigned dots = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (bytes[i] == '.') {
+            dots |= 1u << i;
+        }
+    }
+    return dots;
+}
+
+// IPv6 address with :: compression and an optional dotted quad at the end
+// Returns 0 unless bytes[0..n) is exactly one address
+int parse_ipv6(const char *bytes, size_t n, unsigned char address[16]) {
+    unsigned groups[8];
+    int count = 0;
+    int gap = -1;  // group the :: stands in front of
+    size_t i = 0;
+
+    if (n >= 2 && bytes[0] == ':' && bytes[1] == ':') {
+        gap = 0;
+        i = 2;
+    }
+
+    while (i < n) {
+        // Up to 4 hex digits
+        size_t start = i;
+        unsigned group = 0;
+        while (i < n && i - start < 4 && digit_value[(unsigned char)bytes[i]] < 16) {
+            group = group * 16 + digit_value[(unsigned char)bytes[i]];
+            i++;
+        }
+
+        // A '.' means those were the start of a dotted quad, the last 32 bits
+        if (i < n && bytes[i] == '.') {
+            uint32_t tail;
+            if (count > 6 || n - start > 15 || !parse_ipv4(bytes + start, n - start, find_dots(bytes + start, n - start), &tail)) {
+                return 0;
+            }
+            groups[count++] = tail >> 16;
+            groups[count++] = tail & 0xFFFF;
+            i = n;
+            break;
+        }
+
+        if (i == start || count == 8) {
+            return 0;  // Empty or one group too many
+        }
+        groups[count++] = group;
+
+        if (i == n) {
+            break;
+        }
+        if (bytes[i] != ':') {
+            return 0;
+        }
+        i++;
+        // The one :: allowed
+        if (i < n && bytes[i] == ':') {
+            if (gap >= 0) {
+                return 0;
+            }
+            gap = count;
+            i++;
+        } else if (i == n) {
+            return 0;  // Ends in a single ':'
+        }
+    }
+
+    // Without :: it takes all 8 groups, with it the :: is at least one group of zeros
+    if (gap < 0 ? count != 8 : count > 7) {
+        return 0;
+    }
+
+    int zeros = 8 - count;
+    int out = 0;
+    for (int g = 0; g < count; g++) {
+        if (g == gap) {
+            for (int z = 0; z < zeros; z++, out++) {
+                address[2 * out] = 0;
+                address[2 * out + 1] = 0;
+            }
+        }
+        address[2 * out] = (unsigned char)(groups[g] >> 8);
+        address[2 * out + 1] = (unsigned char)groups[g];
+        out++;
+    }
+    // :: at the very end
+    for (; out < 8; out++) {
+        address[2 * out] = 0;
+        address[2 * out + 1] = 0;
+    }
+    return 1;
+}
+
+// IP address: %I reads a dotted quad into a uint32_t (192.168.0.1 is 0xC0A80001),
+// %lI an IPv6 address into 16 bytes in network order
+// From a window the dots of an IPv4 address are found 16 bytes at a time, then the
+// numbers between them are converted without checking each character again
+int read_address(scan_input *in, scan_args *args, int width, char size_modifier, int suppress) {
+    // Longest textual forms: 255.255.255.255 and ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255
+    size_t max = size_modifier == 'l' ? 45 : 15;
+    char copy[48];
+    const char *bytes = NULL;
+    size_t n = 0;
+    unsigned dots = 0;
+
+    int c = skip_whitespace(in);
+    if (c == EOF) {
+        return 0;  // Failed to read anything
+    }
+
+#ifdef __SSE2__
+    if (in->stream == NULL && size_modifier != 'l') {
+        unread_char(in, c);
+        if (window_available(in) >= 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)(in->data + in->pos));
+            __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+                                           _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+            unsigned dot_bits = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('.')));
+            unsigned other = ~((unsigned)_mm_movemask_epi8(digits) | dot_bits) & 0xFFFF;
+
+            if (other == 0) {
+                return 0;  // 16 digits and dots in a row is too long for an address
+            }
+            n = lowest_set_bit(other);
+            if (width > 0 && (size_t)width < n) {
+                n = width;
+            }
+            bytes = in->data + in->pos;
+            dots = dot_bits & ((1u << n) - 1);
+        } else {
+            c = next_char(in);
+        }
+    }
+#endif
+
+    // Otherwise copy the characters an address can have one at a time
+    if (bytes == NULL) {
+        while (c != EOF && (isdigit(c) || c == '.' || (size_modifier == 'l' && (c == ':' || digit_value[c] < 16)))) {
+            if (n == max) {
+                return 0;  // Too long for an address
+            }
+            copy[n++] = (char)c;
+
+            // Width used up, nothing extra was read
+            if (width > 0 && n >= (size_t)width) {
+                c = EOF;
+                break;
+            }
+            c = next_char(in);
+        }
+        if (c != EOF) {
+            unread_char(in, c);
+        }
+        bytes = copy;
+    }
+
+    if (size_modifier == 'l') {
+        unsigned char address[16];
+        if (!parse_ipv6(bytes, n, address)) {
+            return 0;
+        }
+        if (!suppress) {
+            unsigned char *ptr = next_arg(args);
+            memcpy(ptr, address, 16);
+        }
+        return 1;
+    }
+
+    uint32_t address;
+    if (bytes == copy) {
+        dots = find_dots(copy, n);
+    }
+    if (!parse_ipv4(bytes, n, dots, &address)) {
+        return 0;
+    }
+    if (bytes != copy) {
+        in->pos += n;
+    }
+    if (!suppress) {
+        uint32_t *ptr = next_arg(args);
+        *ptr = address;
+    }
+    return 1;
+}
+
+// Days before the first of each month and days in each month, in a year that isn't a leap year
+static const int days_before_month[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+static const int days_in_month[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+// Leap years from year 1 up to and including year
+long long leap_years_through(long long year) {
+    return year / 4 - year / 100 + year / 400;
+}
+
+// Days from 1970-01-01 to year-month-day (month and day already checked)
+long long days_from_civil(int year, int month, int day) {
+    int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    // Shifted 400 years (146097 days) forward so year 0 doesn't need floor division
+    long long days = 365LL * (year - 1970) + leap_years_through(year + 399) - leap_years_through(1970 + 399);
+    return days + days_before_month[month - 1] + (month > 2 && leap) + day - 1;
+}
+
+// Checks that the bytes picked out by mask are all '0'-'9', 8 at a time
+int all_digits(uint64_t word, uint64_t mask) {
+    uint64_t digits = word & mask;
+    uint64_t high = 0xF0F0F0F0F0F0F0F0ULL & mask;
+    uint64_t thirty = 0x3030303030303030ULL & mask;
+    // 0x30-0x39 have a high nibble of 3 and still do after adding 6, 0x3A-0x3F don't
+    return (digits & high) == thirty && ((digits + (0x0606060606060606ULL & mask)) & high) == thirty;
+}
+
+// Two digit pairs side by side, byte i of the result is 10 * byte i + byte i+1
+// Only the digit bytes (mask) are converted so separators can't borrow from them
+uint64_t digit_pairs(uint64_t word, uint64_t mask) {
+    uint64_t values = (word & mask) - (0x3030303030303030ULL & mask);
+    return values * 10 + (values >> 8);
+}
+
+// ISO 8601 timestamp (%T) like 2026-10-17T12:34:56.789Z, stored as nanoseconds since
+// 1970-01-01 UTC in a long long (unless there's a size modifier)
+// The fixed 19 characters are checked and converted 8 at a time, the fraction (any
+// number of digits, past 9 they're dropped) and the zone (Z, +HH:MM, +HHMM, +HH) are optional
+int read_timestamp(scan_input *in, scan_args *args, char size_modifier, int suppress) {
+    char copy[24];
+    const char *stamp = NULL;
+
+    int c = skip_whitespace(in);
+    if (c == EOF) {
+        return 0;  // Failed to read anything
+    }
+
+    // Straight out of the window when it's all there
+    if (in->stream == NULL) {
+        unread_char(in, c);
+        if (window_available(in) >= 19) {
+            stamp = in->data + in->pos;
+        } else {
+            c = next_char(in);
+        }
+    }
+
+    // Otherwise one character at a time
+    if (stamp == NULL) {
+        copy[0] = (char)c;
+        for (int i = 1; i < 19; i++) {
+            c = next_char(in);
+            if (c == EOF) {
+                return 0;
+            }
+            copy[i] = (char)c;
+        }
+        stamp = copy;
+    }
+
+    // "YYYY-MM-" and "DDTHH:MM", then ":SS"
+    uint64_t date, time;
+    memcpy(&date, stamp, 8);
+    memcpy(&time, stamp + 8, 8);
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    // The masks below have the first character in the lowest byte
+    date = 0;
+    time = 0;
+    for (int i = 7; i >= 0; i--) {
+        date = (date << 8) | (unsigned char)stamp[i];
+        time = (time << 8) | (unsigned char)stamp[8 + i];
+    }
+#endif
+    const uint64_t date_digits = 0x00FFFF00FFFFFFFFULL;
+    const uint64_t time_digits = 0xFFFF00FFFF00FFFFULL;
+
+    if (!all_digits(date, date_digits) || !all_digits(time, time_digits) ||
+        (date & ~date_digits) != 0x2D00002D00000000ULL ||                     // '-' '-'
+        ((time & ~time_digits) != 0x00003A0000540000ULL &&                    // 'T' ':'
+         (time & ~time_digits) != 0x00003A0000740000ULL) ||                   // 't' ':'
+        stamp[16] != ':' || !isdigit((unsigned char)stamp[17]) || !isdigit((unsigned char)stamp[18])) {
+        return 0;  // Not a timestamp
+    }
+
+    uint64_t date_pairs = digit_pairs(date, date_digits);
+    uint64_t time_pairs = digit_pairs(time, time_digits);
+    int year = (int)(date_pairs & 0xFF) * 100 + (int)((date_pairs >> 16) & 0xFF);
+    int month = (int)((date_pairs >> 40) & 0xFF);
+    int day = (int)(time_pairs & 0xFF);
+    int hour = (int)((time_pairs >> 24) & 0xFF);
+    int minute = (int)((time_pairs >> 48) & 0xFF);
+    int second = (stamp[17] - '0') * 10 + (stamp[18] - '0');
+
+    int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if (month < 1 || month > 12 || day < 1 || day > days_in_month[month - 1] + (month == 2 && leap) ||
+        hour > 23 || minute > 59 || second > 60) {
+        return 0;  // Not a real date or time
+    }
+
+    if (stamp != copy) {
+        in->pos += 19;
+    }
+
+    // Fraction of a second (optional), nanoseconds are the first 9 digits
+    unsigned long long nanoseconds = 0;
+    int overflow = 0;
+    c = next_char(in);
+    if (c == '.' || c == ',') {
+        c = next_char(in);
+        // 9 digits always fit, overflow stays 0
+        int digits = read_digits(in, c, 10, 9, &nanoseconds, &overflow);
+        if (digits == 0) {
+            return 0;  // A point has to have digits after it
+        }
+        nanoseconds *= powers_of_10[9 - digits];
+
+        // Anything finer than nanoseconds is dropped
+        unsigned long long finer = 0;
+        int finer_overflow = 0;
+        c = next_char(in);
+        read_digits(in, c, 10, 0, &finer, &finer_overflow);
+        c = next_char(in);
+    }
+
+    // Time zone (optional), no zone means UTC
+    long long offset = 0;
+    if (c == 'Z' || c == 'z') {
+        c = next_char(in);
+    } else if (c == '+' || c == '-') {
+        int zone_sign = c == '-' ? -1 : 1;
+        int zone[4];
+        int count = 0;
+        int colon = 0;
+        c = next_char(in);
+        while (count < 4 && c != EOF) {
+            if (isdigit(c)) {
+                zone[count++] = c - '0';
+            } else if (c == ':' && count == 2 && !colon) {
+                colon = 1;
+            } else {
+                break;
+            }
+            c = next_char(in);
+        }
+        // Hours and optionally minutes, +05 +0530 or +05:30 (a colon needs the minutes)
+        if (count != 4 && (count != 2 || colon)) {
+            return 0;
+        }
+        int zone_hours = zone[0] * 10 + zone[1];
+        int zone_minutes = count == 4 ? zone[2] * 10 + zone[3] : 0;
+        if (zone_hours > 23 || zone_minutes > 59) {
+            return 0;
+        }
+        offset = zone_sign * (zone_hours * 3600LL + zone_minutes * 60);
+    }
+    unread_char(in, c);
+
+    // Local time minus its offset from UTC
+    long long seconds = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+
+    // Nanoseconds since 1970 only fit in a long long from 1677-09-21T00:12:43.145224192
+    // to 2262-04-11T23:47:16.854775807, both ends included
+    const long long limit = LLONG_MAX / 1000000000;
+    const long long lowest = LLONG_MIN / 1000000000 - 1;  // nanoseconds are added, never taken away
+    overflow |= seconds > limit || seconds < lowest ||
+                (seconds == limit && nanoseconds > (unsigned long long)(LLONG_MAX % 1000000000)) ||
+                (seconds == lowest && nanoseconds < (unsigned long long)(1000000000 + LLONG_MIN % 1000000000));
+    // Unsigned math so an out of range date wraps like the other conversions
+    unsigned long long value = (unsigned long long)seconds * 1000000000ULL + nanoseconds;
+    int negative = overflow ? seconds < 0 : (long long)value < 0;
+    unsigned long long magnitude = negative ? 0ULL - value : value;
+
+    return store_signed(args, size_modifier != '\0' ? size_modifier : 'L', suppress, negative, magnitude, overflow);
+}
+
+// One element of a %# array, read with the conversion the array was declared with
+int read_element(scan_input *in, scan_args *args, char specifier, char size_modifier, int precision, int suppress) {
+    switch (specifier) {
+        case 'd':
+            return read_number(in, args, 0, size_modifier, suppress, 10, 1);
+        case 'i':
+            return read_number(in, args, 0, size_modifier, suppress, 0, 1);
+        case 'u':
+            return read_number(in, args, 0, size_modifier, suppress, 10, 0);
+        case 'o':
+            return read_number(in, args, 0, size_modifier, suppress, 8, 0);
+        case 'x':
+        case 'X':
+            return read_number(in, args, 0, size_modifier, suppress, 16, 0);
+        case 'b':
+            return read_number(in, args, 0, size_modifier, suppress, 2, 0);
+        case 'f':
+        case 'a':
+        case 'A':
+            return read_float(in, args, 0, size_modifier, suppress);
+        case 'D':
+            return read_fixed(in, args, 0, size_modifier, suppress, precision);
+        default:
+            return 0;  // Not a numeric conversion
+    }
+}
+
+// Bytes each element of a %# array takes, 0 for conversions that can't be in an array
+size_t element_size(char specifier, char size_modifier) {
+    if (specifier == 'f' || specifier == 'a' || specifier == 'A') {
+        if (size_modifier == 'l') {
+            return sizeof(double);
+        }
+        return size_modifier == 'L' ? sizeof(long double) : sizeof(float);
+    }
+    if (strchr("diuoxXbD", specifier) == NULL || specifier == '\0') {
+        return 0;
+    }
+    switch (size_modifier) {
+        case 'H': return sizeof(signed char);
+        case 'h': return sizeof(short);
+        case 'l': return sizeof(long);
+        case 'L': return sizeof(long long);
+#ifdef __SIZEOF_INT128__
+        case 'W': return sizeof(__int128);
+#endif
+        default:  return specifier == 'D' ? sizeof(long long) : sizeof(int);
+    }
+}
+
+// Counted array (%#d, %#lf, ...): a count followed by that many elements, like "3 10 20 30"
+// Takes an int* for the count and the array (a T** for %#m, which allocates it like %ms)
+// The width is the capacity of the caller's array, a longer list is a matching failure
+// The elements go through the same readers as single conversions, just without going
+// back through the format string and the argument list for each one
+int read_array(scan_input *in, scan_args *args, int width, char specifier, char size_modifier,
+               int precision, int suppress, int allocate) {
+    size_t size = element_size(specifier, size_modifier);
+    if (size == 0) {
+        return 0;
+    }
+
+    int *count_result = NULL;
+    char *array = NULL;
+    char **result = NULL;
+    text_output out;
+
+    if (!suppress) {
+        count_result = next_arg(args);
+        if (allocate) {
+            result = next_arg(args);
+            // Arena strings have no alignment, line the array up for any element type
+            // (malloc'd storage and the arena's overflow blocks already are)
+            my_scan_arena *arena = current_arena;
+            if (arena != NULL && arena->memory != NULL) {
+                size_t pad = (size_t)(-(uintptr_t)(arena->memory + arena->used)) & (_Alignof(max_align_t) - 1);
+                arena->used = arena->used + pad <= arena->size ? arena->used + pad : arena->size;
+            }
+            start_allocated_text(&out, arena);
+        } else {
+            array = next_arg(args);
+        }
+    }
+
+    // The count is a plain int
+    int count = 0;
+    void *count_slot = &count;
+    scan_args count_args = {NULL, &count_slot, 0};
+    if (!read_number(in, &count_args, 0, '\0', 0, 10, 1) || count < 0 ||
+        (width > 0 && count > width)) {
+        if (allocate && !suppress) {
+            discard_text(&out);
+        }
+        return 0;
+    }
+
+    // Elements either go straight into the caller's array or through a
+    // temporary into the storage we're growing
+    union {
+        long double f;
+        unsigned long long i[2];
+    } element;
+
+    for (int i = 0; i < count; i++) {
+        void *slot = (array != NULL) ? array + (size_t)i * size : (void *)&element;
+        scan_args element_args = {NULL, &slot, 0};
+
+        if (!read_element(in, &element_args, specifier, size_modifier, precision, suppress)) {
+            if (allocate && !suppress) {
+                discard_text(&out);
+            }
+            return 0;
+        }
+        if (allocate && !suppress && !put_chars(&out, (const char *)&element, size)) {
+            discard_text(&out);
+            return 0;  // Out of memory for %#m
+        }
+    }
+
+    if (!suppress) {
+        if (allocate && !finish_text(&out, result, 0)) {
+            discard_text(&out);
+            return 0;
+        }
+        *count_result = count;
+    }
+    return 1;
+}
+
+// One piece of the format string, parsed once so it can be run over and over
+typedef struct {
+    char kind;           // 'w' whitespace, 'l' literal character, '%' conversion,
+                         // '{' '|' '}' start, separator and end of a repetition group
+    char literal;        // character to match for 'l'
+    char specifier;      // conversion specifier for '%'
+    char size_modifier;  // h, H (hh), l, L (ll or L), W (w128) or '\0'
+    int width;           // 0 means unlimited
+    int precision;       // digits after the point for %D (the 4 in %.4D), 0 when not given
+    int suppress;        // '*' was given
+    int array;           // '#' was given, a count and then that many elements
+    int allocate;        // 'm' was given, we allocate the storage for %s %c %N
+    int intern;          // 'k' was given, %s stores a pointer to the one shared copy of the string
+} format_directive;
+
+// Parses the directive starting at format[*i] and moves *i past it
+// Returns 0 when the end of the format string is reached
+int parse_directive(const char *format, int *i, format_directive *directive) {
+    int pos = *i;
+
+    if (format[pos] == '\0') {
+        return 0;
+    }
+
+    directive->literal = '\0';
+    directive->specifier = '\0';
+    directive->size_modifier = '\0';
+    directive->width = 0;
+    directive->precision = 0;
+    directive->suppress = 0;
+    directive->array = 0;
+    directive->allocate = 0;
+    directive->intern = 0;
+
+    // Check for literal characters or whitespace
+    if (format[pos] != '%') {
+        directive->kind = isspace(format[pos]) ? 'w' : 'l';
+        directive->literal = format[pos];
+        *i = pos + 1;
+        return 1;
+    }
+    // At this point we have a '%' so see what follows it to determine which format specifier to use
+    pos++;
+
+    // Check for '%%' (literal %)
+    if (format[pos] == '%') {
+        directive->kind = 'l';
+        directive->literal = '%';
+        *i = pos + 1;
+        return 1;
+    }
+
+    directive->kind = '%';
+
+    // Check for assignment suppression '*'
+    // Will read from the input stream, but not store the value
+    if (format[pos] == '*') {
+        directive->suppress = 1;
+        pos++;
+    }
+
+    // Counted array '#', the conversion is read count times
+    if (format[pos] == '#') {
+        directive->array = 1;
+        pos++;
+    }
+
+    // Parse width (optional modifier)
+    // if there is a digit following the % it is a width modifier
+    // if no digit the loop doesn't run so width stays at 0 meaning unlimited
+    while (isdigit(format[pos])) {
+        // Convert string numbers to values
+        // ascii value of the number - the ascii value of 0 = the number
+        // * 10 to account for the place when a new digit is added to the right
+        directive->width = directive->width * 10 + (format[pos] - '0');
+        pos++;
+    }
+
+    // Parse precision (optional, only used by %D), same as the width after a '.'
+    if (format[pos] == '.') {
+        pos++;
+        while (isdigit(format[pos])) {
+            directive->precision = directive->precision * 10 + (format[pos] - '0');
+            pos++;
+        }
+    }
+
+    // Assignment-allocation 'm' (POSIX), the argument is a char** and we allocate the string
+    if (format[pos] == 'm') {
+        directive->allocate = 1;
+        pos++;
+    }
+
+    // Interning 'k', the argument is a const char** that gets the table's copy of the string
+    if (format[pos] == 'k') {
+        directive->intern = 1;
+        pos++;
+    }
+
+    // Parse size modifier (h, hh, l, ll, L)
+    if (format[pos] == 'h') {
+        pos++;
+        if (format[pos] == 'h') {
+            directive->size_modifier = 'H';  // hh
+            pos++;
+        } else {
+            directive->size_modifier = 'h';  // h
+        }
+    } else if (format[pos] == 'l') {
+        pos++;
+        if (format[pos] == 'l') {
+            directive->size_modifier = 'L';  // ll
+            pos++;
+        } else {
+            directive->size_modifier = 'l';  // l
+        }
+    } else if (format[pos] == 'L') {
+        directive->size_modifier = 'L';  // long double (for %f)
+        pos++;
+#ifdef __SIZEOF_INT128__
+    } else if (strncmp(format + pos, "w128", 4) == 0) {
+        directive->size_modifier = 'W';  // __int128 (for the integer conversions)
+        pos += 4;
+#endif
+    }
+
+    directive->specifier = format[pos];
+    // Don't step past the end of the string if the format ends in the middle of a directive
+    if (format[pos] != '\0') {
+        pos++;
+    }
+
+    // %{ %| %} mark out a repetition group rather than converting anything
+    if (directive->specifier == '{' || directive->specifier == '|' || directive->specifier == '}') {
+        directive->kind = directive->specifier;
+    }
+
+    *i = pos;
+    return 1;
+}
+
+// Runs one directive against the input
+// Returns 1 if it matched (or converted something), 0 on a matching failure
+int run_directive(scan_input *in, const format_directive *directive, scan_args *args) {
+    if (directive->kind == 'w') {
+        // Consume any amount of whitespace from input stream
+        int c = skip_whitespace(in);
+        // When you find a non whitespace character return it to the stream
+        // so it can be read by the next format specifier
+        if (c != EOF) {
+            unread_char(in, c);
+        }
+        return 1;
+    }
+
+    if (directive->kind == 'l') {
+        // Match literal characters exactly
+        int c = next_char(in);
+        if (c != directive->literal) {
+            // Mismatch - matching failure
+            if (c != EOF) {
+                unread_char(in, c);
+            }
+            return 0;
+        }
+        return 1;
+    }
+
+    // Groups are run by the callers with run_group, a marker on its own doesn't match anything
+    if (directive->kind != '%') {
+        return 0;
+    }
+
+    int width = directive->width;
+    char size_modifier = directive->size_modifier;
+    int suppress = directive->suppress;
+    int allocate = directive->allocate;
+
+    // Arrays read their count and elements themselves
+    if (directive->array) {
+        if (directive->intern) {
+            return 0;
+        }
+        return read_array(in, args, width, directive->specifier, size_modifier, directive->precision, suppress, allocate);
+    }
+
+    // Only the text conversions know how to allocate their storage, and only %s interns
+    if (allocate && directive->specifier != 's' && directive->specifier != 'c' && directive->specifier != 'N' &&
+        directive->specifier != 'Z') {
+        return 0;
+    }
+    if (directive->intern && (allocate || directive->specifier != 's')) {
+        return 0;
+    }
+
+    // Determine which format specifier to use
+    switch (directive->specifier) {
+        case 'd':
+            return read_number(in, args, width, size_modifier, suppress, 10, 1);
+        case 'i':
+            return read_number(in, args, width, size_modifier, suppress, 0, 1);
+        case 'u':
+            return read_number(in, args, width, size_modifier, suppress, 10, 0);
+        case 'o':
+            return read_number(in, args, width, size_modifier, suppress, 8, 0);
+        case 'f':
+        case 'a':
+        case 'A':
+            return read_float(in, args, width, size_modifier, suppress);
+        case 'x':
+        case 'X':
+            return read_number(in, args, width, size_modifier, suppress, 16, 0);
+        case 'c':
+            return read_char(in, args, width, suppress, allocate);
+        case 's':
+            return read_string(in, args, width, suppress, allocate, directive->intern);
+        case 'b':
+            return read_number(in, args, width, size_modifier, suppress, 2, 0);
+        case 'B':
+            return read_boolean(in, args, width, suppress);
+        case 'N':
+            return read_line(in, args, width, suppress, allocate);
+        case 'D':
+            return read_fixed(in, args, width, size_modifier, suppress, directive->precision);
+        case 'T':
+            return read_timestamp(in, args, size_modifier, suppress);
+        case 'I':
+            return read_address(in, args, width, size_modifier, suppress);
+        case 'U':
+            return read_hex_bytes(in, args, width, suppress);
+        case 'Z':
+            return read_base64(in, args, width, suppress, allocate);
+
+        default:
+            // Unknown format specifier is a matching failure
+            return 0;
+    }
+}
+
+// Most conversions one repetition group can fill
+#define SCAN_GROUP_FIELDS 16
+
+// Directives in a group parse_format_string can keep on the stack, bigger ones are malloc'd
+#define SCAN_GROUP_DIRECTIVES 64
+
+// Distance between the elements of the array a conversion in a group fills,
+// 0 for conversions that can't be repeated that way
+size_t group_stride(const format_directive *directive) {
+    if (directive->array || directive->specifier == 'Z') {
+        return 0;  // These take more than one argument
+    }
+    if (directive->allocate || directive->intern) {
+        return sizeof(char *);  // An array of char*
+    }
+
+    switch (directive->specifier) {
+        case 'c':
+            return directive->width > 0 ? directive->width : 1;
+        case 's':
+        case 'N':
+            // Fixed size strings, the width says how long they can be
+            return directive->width > 0 ? directive->width + 1 : 0;
+        case 'B':
+            return sizeof(int);
+        case 'T':
+            return element_size('D', directive->size_modifier);
+        case 'I':
+            return directive->size_modifier == 'l' ? 16 : sizeof(uint32_t);
+        case 'U':
+            return directive->width > 0 ? directive->width : 16;
+        default:
+            return element_size(directive->specifier, directive->size_modifier);
+    }
+}
+
+// Repetition group %{body%|separator%}, with group[0] the %{ and the %} left off
+// The body is read over and over with the separator (literals and whitespace only) matched
+// in between, until the separator or the body doesn't match or the width (the capacity of
+// the arrays) is reached. A repetition that doesn't match all the way is given back to the
+// input together with the separator before it, so "1,2," leaves the last ',' for what follows
+// Takes an int* for the number of repetitions and then an array for every conversion in
+// the body, so "%4{(%d,%f)%|,%}" fills an int array and a float array side by side
+// Groups that store need the width, a suppressed group can go on without limit
+// Returns 0 when the group itself is malformed, or a stream can't give back that much
+int run_group(scan_input *in, const format_directive *group, int count, scan_args *args) {
+    int suppress = group[0].suppress;
+    int capacity = group[0].width;
+    int *count_result = NULL;
+    char *bases[SCAN_GROUP_FIELDS];
+    size_t strides[SCAN_GROUP_FIELDS];
+    int fields = 0;
+
+    // Split it into body and separator
+    int separator = count;
+    for (int d = 1; d < count; d++) {
+        if (group[d].kind == '{' || (group[d].kind == '|' && separator != count)) {
+            return 0;  // No nested groups and only one separator
+        }
+        if (group[d].kind == '|') {
+            separator = d;
+        } else if (group[d].kind == '%' && separator != count) {
+            return 0;  // The separator can't convert anything
+        }
+    }
+    if (separator == 1) {
+        return 0;  // Nothing to repeat
+    }
+    if (!suppress && capacity == 0) {
+        return 0;  // No way to know how long the caller's arrays are
+    }
+
+    // One array per conversion in the body
+    if (!suppress) {
+        count_result = next_arg(args);
+    }
+    for (int d = 1; d < separator; d++) {
+        if (group[d].kind != '%' || group[d].suppress || suppress) {
+            continue;
+        }
+        size_t stride = group_stride(&group[d]);
+        if (stride == 0 || fields == SCAN_GROUP_FIELDS) {
+            return 0;
+        }
+        bases[fields] = next_arg(args);
+        strides[fields] = stride;
+        fields++;
+    }
+
+    int repetitions = 0;
+    while (capacity == 0 || repetitions < capacity) {
+        // Everything from here on goes back if the repetition doesn't match all the way
+        size_t mark = checkpoint(in);
+
+        // Separator between repetitions
+        int matched = 1;
+        for (int d = separator + 1; d < count && repetitions > 0; d++) {
+            if (!run_directive(in, &group[d], args)) {
+                matched = 0;
+                break;
+            }
+        }
+
+        // The body, each conversion stores into element [repetitions] of its array
+        int field = 0;
+        for (int d = 1; d < separator && matched; d++) {
+            format_directive directive = group[d];
+            void *slot = NULL;
+            scan_args element = {NULL, &slot, 0};
+
+            if (directive.kind == '%' && !directive.suppress) {
+                if (suppress) {
+                    directive.suppress = 1;
+                } else {
+                    slot = bases[field] + (size_t)repetitions * strides[field];
+                    field++;
+                }
+            }
+
+            if (!run_directive(in, &directive, &element)) {
+                matched = 0;
+            }
+        }
+
+        // The group ends at the last repetition that matched
+        if (!matched) {
+            if (!rollback(in, mark)) {
+                return 0;
+            }
+            break;
+        }
+        // A body of only whitespace can match nothing at all, over and over
+        size_t now = in->stream != NULL ? in->history.journal_length : in->history.offset + in->pos;
+        release_checkpoint(in);
+        if (now == mark) {
+            break;
+        }
+        repetitions++;
+    }
+
+    if (!suppress) {
+        *count_result = repetitions;
+    }
+    return 1;
+}
+
+// Number of directives in the group that starts at directives[0], up to and including its %}
+// Returns 0 if it's never closed
+int group_size(const format_directive *directives, int count) {
+    for (int d = 1; d < count; d++) {
+        if (directives[d].kind == '}') {
+            return d + 1;
+        }
+    }
+    return 0;
+}
+
+// Reads the input according to format, parsing the format as it goes
+// If stopped isn't NULL it gets the index of the directive that failed to match,
+// or -1 when the whole format matched (the number of directives isn't known up front)
+int parse_format_string(scan_input *in, const char *format, scan_args *args, int *stopped) {
+    int successful = 0;
+    int i = 0;
+    int d = 0;  // index of the directive, counted the same way as in run_directives
+    format_directive directive;
+
+    overflow_count = 0;
+    if (stopped != NULL) {
+        *stopped = 0;
+    }
+
+    while (parse_directive(format, &i, &directive)) {
+        if (stopped != NULL) {
+            *stopped = d;
+        }
+        if (directive.kind == '{') {
+            // Parse the whole group once, then it's run as a loop over the parsed directives
+            // Every directive uses at least one character, that's how many there can be at most
+            format_directive table[SCAN_GROUP_DIRECTIVES];
+            format_directive *group = table;
+            size_t most = strlen(format + i) + 2;
+            if (most > SCAN_GROUP_DIRECTIVES) {
+                group = malloc(most * sizeof(format_directive));
+                if (group == NULL) {
+                    return successful;
+                }
+            }
+            int count = 1;
+            int closed = 0;
+            group[0] = directive;
+            while (parse_directive(format, &i, &group[count])) {
+                if (group[count].kind == '}') {
+                    closed = 1;
+                    break;
+                }
+                count++;
+            }
+            int matched = closed && run_group(in, group, count, args);
+            if (group != table) {
+                free(group);
+            }
+            if (!matched) {
+                return successful;
+            }
+            d += count;  // the rest of the group and the %}
+        } else if (!run_directive(in, &directive, args)) {
+            // Matching failure - return however many successful conversions have occurred up to this point
+            return successful;
         }
-        // We can still read in more digits, go to the next one
-        c = getchar();
-    }
-
-    // Read digits
-    while (c != EOF && isdigit(c)) {
-        // Convert string numbers to values
-        value = value * 10 + (c - '0');
-        digit_count++;
-        chars_read++;
 
-        // Check width limit after each digit read in, unless width is 0 ie unlimited 
-        if (width > 0 && chars_read >= width) {
-            break;
+        // If we successfully read something, and it's not suppressed, increment count
+        if ((directive.kind == '%' || directive.kind == '{') && !directive.suppress) {
+            successful++;
         }
-
-        c = getchar();
+        d++;
     }
 
-    // Put back the non-digit character we just read (if not EOF)
-    if (c != EOF && !isdigit(c)) {
-        ungetc(c, stdin);
+    if (stopped != NULL) {
+        *stopped = -1;  // Everything matched
     }
+    return successful;
+}
 
-    // Check if we actually read any digits
-    if (digit_count == 0) {
-        return 0;  // Failed - no digits found
-    }
+// Same as parse_format_string but for a format that was already parsed into directives
+// If stopped isn't NULL it gets the index of the directive that failed to match,
+// or count when the whole format matched (not -1, the callers know the count)
+int run_directives(scan_input *in, const format_directive *directives, int count, scan_args *args, int *stopped) {
+    int successful = 0;
+    int d;
 
-    // Apply sign (optional)
-    value *= sign;
+    overflow_count = 0;
 
-    // Get the pointer (next argument from va_list) to where we should store the result we read
-    // Store based on size modifier, but do not store the value if assignment suppression
-    if (!suppress) {
-        if (size_modifier == 'h') {
-            // short
-            short *ptr = va_arg(args, short*);
-            *ptr = (short)value;
-        } else if (size_modifier == 'H') {
-            // char (hh modifier - using 'H' to represent)
-            signed char *ptr = va_arg(args, signed char*);
-            *ptr = (signed char)value;
-        } else if (size_modifier == 'l') {
-            // long
-            long *ptr = va_arg(args, long*);
-            *ptr = (long)value;
-        } else if (size_modifier == 'L') {
-            // long long (ll modifier - using 'L' to represent)
-            long long *ptr = va_arg(args, long long*);
-            *ptr = value;
-        } else {
-            // regular int (default)
-            int *ptr = va_arg(args, int*);
-            *ptr = (int)value;
+    for (d = 0; d < count; d++) {
+        if (directives[d].kind == '{') {
+            int size = group_size(&directives[d], count - d);
+            if (size == 0 || !run_group(in, &directives[d], size - 1, args)) {
+                break;
+            }
+            if (!directives[d].suppress) {
+                successful++;
+            }
+            // Carry on after the %}
+            d += size - 1;
+            continue;
+        }
+        if (!run_directive(in, &directives[d], args)) {
+            break;
+        }
+        if (directives[d].kind == '%' && !directives[d].suppress) {
+            successful++;
         }
     }
-    return 1;
+
+    if (stopped != NULL) {
+        *stopped = d;
+    }
+    return successful;
 }
 
-int read_float(const va_list args, int width, char size_modifier, int suppress) {
-    int c;
-    int chars_read = 0;
-    int sign = 1;
+// Parses the whole format string up front, the caller frees the result
+// Returns NULL if memory could not be allocated
+format_directive *compile_format(const char *format, int *count) {
+    // Every directive uses at least one character of the format
+    format_directive *directives = malloc((strlen(format) + 1) * sizeof(format_directive));
+    int i = 0;
 
-    double int_part = 0.0;
-    double frac_part = 0.0;
-    double frac_divisor = 1.0;
+    *count = 0;
+    if (directives == NULL) {
+        return NULL;
+    }
 
-    int saw_digit = 0;
-    int saw_fraction = 0;
-    int saw_exponent = 0;
+    while (parse_directive(format, &i, &directives[*count])) {
+        (*count)++;
+    }
 
-    int exp_sign = 1;
-    int exponent = 0;
+    return directives;
+}
 
-    // Consume all leading whitespace
-    while ((c = getchar()) != EOF && isspace(c)) {}
+int my_scanf(const char *format, ...) {
+    scan_input in = {stdin, NULL, 0, 0, NULL, NULL, NULL, 0, 0, 0, {0}};
+    va_list list;
+    va_start(list, format);
 
-    if (c == EOF) {
-        return 0;  // Failed to read anything
-    }
+    scan_args args = {&list, NULL, 0};
+    int result = parse_format_string(&in, format, &args, NULL);
+    finish_input(&in);
 
-    // Check for optional sign
-    if (c == '+' || c == '-') {
-        if (c == '-') {
-            sign = -1;
-        }
-        chars_read++;
+    va_end(list);
+    return result;
+}
 
-        // Check if we've hit width limit after just the sign
-        // Don't check if the width limit is 0 ie unlimited
-        if (width > 0 && chars_read >= width) {
-            return 0;  // No digits read, just a sign
+// Fills in how far a stream input got, from the cursor kept by next_char
+// Everything still in pushed was fetched last, so it's taken back off the counts.
+// A rolled back group can put back several newlines, the line the cursor ends up on
+// is still in line_starts since pushed never holds more than SCAN_LOOKAHEAD of them
+void describe_position(const scan_input *in, my_scan_result *result) {
+    const scan_history *history = &in->history;
+    const scan_position *position = history->position;
+    size_t newlines_put_back = 0;
+
+    for (int i = 0; i < history->pushed_count; i++) {
+        if (history->pushed[i] == '\n') {
+            newlines_put_back++;
         }
-        // We can still read in more digits, go to the next one
-        c = getchar();
     }
 
-    // Integer part before the decimal point, same as in %d
-    while (c != EOF && isdigit(c)) {
-        saw_digit = 1;
-        int_part = int_part * 10.0 + (c - '0');
-        chars_read++;
-
-        if (width > 0 && chars_read >= width) {
-            break;
-        }
+    size_t newlines = position->newlines - newlines_put_back;
+    result->consumed = position->fetched - history->pushed_count;
+    result->line = newlines + 1;
+    result->column = result->consumed - position->line_starts[newlines % (SCAN_LOOKAHEAD + 1)] + 1;
+}
 
-        c = getchar();
-    }
+int my_scanf_ex(my_scan_result *result, const char *format, ...) {
+    scan_input in = {stdin, NULL, 0, 0, NULL, NULL, NULL, 0, 0, 0, {0}};
+    scan_position position = {0};
+    in.history.position = &position;
+    va_list list;
+    va_start(list, format);
 
-    //  Fractional part after decimal point
-    if (c == '.' && (width == 0 || chars_read < width)) {
-        saw_fraction = 1;
-        chars_read++;
+    scan_args args = {&list, NULL, 0};
+    int stopped;
+    int conversions = parse_format_string(&in, format, &args, &stopped);
 
-        c = getchar();
+    // Nothing above looks at the position, it's all worked out once here
+    result->conversions = conversions;
+    result->directive = stopped;
+    describe_position(&in, result);
+    if (stopped < 0) {
+        result->failure = MY_SCAN_COMPLETE;
+    } else if (overflow_count > 0 && overflow_policy == MY_SCAN_OVERFLOW_FAIL) {
+        // An overflow stops the scan right away with this policy, so it was the failing directive
+        result->failure = MY_SCAN_FAILED_OVERFLOW;
+    } else if (in.history.pushed_count == 0 && (feof(stdin) || ferror(stdin))) {
+        result->failure = MY_SCAN_FAILED_EOF;
+    } else {
+        result->failure = MY_SCAN_FAILED_MISMATCH;
+    }
+    finish_input(&in);
 
-        while (c != EOF && isdigit(c) && (width == 0 || chars_read < width)) {
-            saw_digit = 1;
-            // Same conversion logic as %d
-            frac_part = frac_part * 10.0 + (c - '0');
-            // Divisor is basically the tenth, hundredth, etc. place
-            frac_divisor *= 10.0;
-            chars_read++;
+    va_end(list);
+    return conversions;
+}
 
-            if (width > 0 && chars_read >= width) break;
+int my_scan_each(FILE *stream, const char *format, my_scan_callback callback, void *user_data, ...) {
+    int count;
+    format_directive *directives = compile_format(format, &count);
+    char *buffer = malloc(SCAN_WINDOW_SIZE);
 
-            c = getchar();
-        }
+    if (directives == NULL || buffer == NULL) {
+        free(directives);
+        free(buffer);
+        return EOF;
     }
 
-    // Exponent part (optional)
-    if ((c == 'e' || c == 'E') && (width == 0 || chars_read < width)) {
-        saw_exponent = 1;
-        chars_read++;
-
-        c = getchar();
+    // Nobody else gets to touch the stream until we're done with it, the fread of
+    // every refill still takes the lock but it's already ours so that's cheap
+    lock_stream(stream);
 
-        // Exponent sign (optional)
-        if (c == '+' || c == '-') {
-            if (c == '-') {
-                exp_sign = -1;
-            }
-            chars_read++;
-            c = getchar();
-        }
+    scan_input in = {NULL, buffer, 0, 0, NULL, stream, buffer, SCAN_WINDOW_SIZE, 0, 0, {0}};
+    int records = 0;
 
-        // Calculate exponent digits
-        int exp_digits = 0;
-        while (c != EOF && isdigit(c) && (width == 0 || chars_read < width)) {
-            exponent = exponent * 10 + (c - '0');
-            exp_digits++;
-            chars_read++;
+    va_list list;
+    va_start(list, user_data);
 
-            // Stop if you reach the width maximum
-            if (width > 0 && chars_read >= width) {
-                break;
-            }
+    for (;;) {
+        // Every record fills the same variables so start from the first pointer again
+        va_list record_list;
+        va_copy(record_list, list);
+        scan_args args = {&record_list, NULL, 0};
+        size_t record_start = checkpoint(&in);
+        int stopped;
+        int fields = run_directives(&in, directives, count, &args, &stopped);
+        va_end(record_list);
 
-            c = getchar();
-        }
-        // No digits after the e for exponentiation
-        if (exp_digits == 0) {
-            // push back previous char
-            if (c != EOF) {
-                ungetc(c, stdin);
-            }
-            // Ignore exponent entirely, only calculate digits preceding e
-            exponent = 0;
-            saw_exponent = 0;
+        // A record is there when the whole format matched (all of it may be suppressed)
+        // or at least something was converted. Otherwise it's EOF or input that doesn't
+        // match the format anymore, go back to the start of the record so the caller
+        // gets all of it back. Not moving at all would be the same record forever
+        int matched = fields > 0 || stopped == count;
+        if (!matched || in.history.offset + in.pos == record_start) {
+            rollback(&in, record_start);
+            break;
         }
-    }
+        release_checkpoint(&in);
 
-    // Put back extra character if it is NOT part of the float
-    if (c != EOF && !isspace(c)) {
-        // These are valid characters in a float that are not numeric
-        if (!isdigit(c) && c != '.' && c != 'e' && c != 'E' && c != '+' && c != '-') {
-            ungetc(c, stdin);
+        records++;
+        if (callback(user_data, fields) != 0) {
+            break;
         }
     }
 
-    // No digits were read at all
-    if (!saw_digit) {
-        return 0;
+    va_end(list);
+
+    // Give back whatever we read ahead so the caller can keep using the stream
+    // (only possible when the stream is seekable, see my_scanf.h)
+    if (in.pos < in.length) {
+        fseek(stream, -(long)(in.length - in.pos), SEEK_CUR);
     }
 
-    // Calculate final float based on exponents and fractions
-    double value = int_part;
+    unlock_stream(stream);
+    free(directives);
+    free(in.buffer);  // Refills can move it to a bigger buffer
+    return records;
+}
 
-    // Add the 'fraction' that goes after the decimal point
-    if (saw_fraction) {
-        value += frac_part / frac_divisor;
-    }
 
-    // Add optional sign
-    value *= sign;
+// State kept between my_scan_push_feed calls
+struct my_scan_push {
+    format_directive *directives;
+    int count;
+    void **pointers;            // field pointers given to my_scan_push_create, in order
+    my_scan_callback callback;
+    void *user_data;
+    char *pending;              // bytes fed to us that aren't part of a finished record yet
+    size_t pending_length;
+    size_t pending_capacity;
+    int failed;                 // a record didn't match the format, nothing more can be parsed
+};
 
-    // Exponent math
-    if (saw_exponent && exponent != 0) {
-        double pow10 = 1.0;
-        // exponent of 1 if just * 10, 2 is * 100, 3 is *1000, etc
-        for (int i = 0; i < exponent; i++) {
-            pow10 *= 10.0;
-        }
-        // negative exponent moves decimal point to the left, positive moves to the right
-        if (exp_sign == -1)
-            value /= pow10;
-        else
-            value *= pow10;
-    }
+// Number of field pointers the directives take from the caller
+int count_fields(const format_directive *directives, int count) {
+    int fields = 0;
 
-    // Store based on size modifier
-    if (!suppress) {
-        if (size_modifier == 'l') {
-            double *ptr = va_arg(args, double*);
-            *ptr = value;
-        } else if (size_modifier == 'L') {
-            long double *ptr = va_arg(args, long double*);
-            *ptr = (long double)value;
-        } else {
-            float *ptr = va_arg(args, float*);
-            *ptr = (float)value;
+    for (int d = 0; d < count; d++) {
+        if (directives[d].kind == '{') {
+            if (directives[d].suppress) {
+                // Nothing in a suppressed group is stored
+                int size = group_size(&directives[d], count - d);
+                d += size > 0 ? size - 1 : count;
+            } else {
+                fields++;  // the int* for the number of repetitions
+            }
+        } else if (directives[d].kind == '%' && !directives[d].suppress) {
+            // %Z also takes the size_t* for its length and arrays the int* for their count
+            fields += (directives[d].specifier == 'Z' || directives[d].array) ? 2 : 1;
         }
     }
-    return 1;
+    return fields;
 }
 
-int read_hex(const va_list args, int width, char size_modifier, int suppress) {
-    int c;
-    unsigned long long value = 0;
-    int digit_count = 0;
-    int chars_read = 0;
+my_scan_push *my_scan_push_create(const char *format, my_scan_callback callback, void *user_data, ...) {
+    my_scan_push *ctx = calloc(1, sizeof(my_scan_push));
+    if (ctx == NULL) {
+        return NULL;
+    }
 
-    // Consume all leading whitespace
-    while ((c = getchar()) != EOF && isspace(c)) {}
+    ctx->callback = callback;
+    ctx->user_data = user_data;
+    ctx->directives = compile_format(format, &ctx->count);
+    if (ctx->directives == NULL) {
+        my_scan_push_free(ctx);
+        return NULL;
+    }
 
-    if (c == EOF) {
-        return 0;  // Failed to read anything
+    // Keep our own copy of the field pointers, the va_list is gone once we return
+    int fields = count_fields(ctx->directives, ctx->count);
+    ctx->pointers = malloc((fields + 1) * sizeof(void *));
+    if (ctx->pointers == NULL) {
+        my_scan_push_free(ctx);
+        return NULL;
     }
 
-    // Handle 0x or 0X prefix (optional)
-    if (c == '0') {
-        chars_read++;
+    va_list list;
+    va_start(list, user_data);
+    for (int f = 0; f < fields; f++) {
+        ctx->pointers[f] = va_arg(list, void *);
+    }
+    va_end(list);
 
-        // Check if we've hit width limit after just the '0'
-        // Don't check if the width limit is 0 ie unlimited
-        if (width > 0 && chars_read >= width) {
-            // Just read a 0 without x, treat it as a hex digit
-            value = 0;
-            digit_count = 1;
-        } else {
-            // We can still read more, check for 'x' or 'X'
-            int next = getchar();
-            if (next == 'x' || next == 'X') {
-                // 0x prefix found, this counts toward width but not as a digit
-                chars_read++;
+    return ctx;
+}
 
-                // Check width limit after the prefix
-                if (width > 0 && chars_read >= width) {
-                    return 0;  // No hex digits read, just "0x"
-                }
+// Runs the format over the pending bytes for as many whole records as there are
+// A record that runs out of bytes before it is finished is rolled back and kept
+// for the next feed, where it is parsed again from its first byte
+int push_records(my_scan_push *ctx, int more_coming) {
+    scan_input in = {NULL, ctx->pending, 0, ctx->pending_length, NULL, NULL, NULL, 0, more_coming, 0, {0}};
+    size_t record_start = 0;
+    int records = 0;
+    scan_allocations allocations = {NULL, 0, 0};
+    my_scan_arena *arena = current_arena;
 
-                // Continue with reading hex digits
-                c = getchar();
-            } else {
-                // Just a leading 0, process it as a hex digit
-                ungetc(next, stdin);
-                // c is already '0', will be processed below
-                value = 0;
-                digit_count = 1;
-                c = getchar();
-            }
-        }
-    }
+    while (record_start < ctx->pending_length) {
+        scan_args args = {NULL, ctx->pointers, 0};
+        in.pos = record_start;
 
-    // Read hexadecimal digits after optional prefix
-    while (c != EOF) {
-        int hex_value = -1;
+        // What the arena looked like before the record, in case it has to be parsed again
+        size_t arena_used = arena != NULL ? arena->used : 0;
+        my_scan_arena_block *arena_overflow = arena != NULL ? arena->overflow : NULL;
+        allocations.count = 0;
+        current_allocations = &allocations;
+        int stopped;
+        int fields = run_directives(&in, ctx->directives, ctx->count, &args, &stopped);
+        current_allocations = NULL;
 
-        if (c >= '0' && c <= '9') {
-            // convert valid hex digits from ascii value to int value
-            hex_value = c - '0';
-        // convert valid hex chars from ascii value to int value (a/A=10, b/B=11, etc)
-        } else if (c >= 'a' && c <= 'f') {
-            hex_value = c - 'a' + 10;
-        } else if (c >= 'A' && c <= 'F') {
-            hex_value = c - 'A' + 10;
-        } else {
-            // Not a hex digit, put it back
-            ungetc(c, stdin);
+        // The record isn't all here yet (a number could still have more digits coming)
+        // It's parsed from the start again once it is, so anything it allocated goes
+        if (in.starved) {
+            for (size_t i = 0; i < allocations.count; i++) {
+                free(allocations.results[i]);
+            }
+            if (arena != NULL) {
+                rewind_arena(arena, arena_used, arena_overflow);
+            }
             break;
         }
 
-        // If we found a valid hex digit, add it to value
-        if (hex_value != -1) {
-            // same conversion as in %d and %f, just in base 16 this time
-            value = value * 16 + hex_value;
-            digit_count++;
-            chars_read++;
-
-            // Check width limit after each digit read in, unless width is 0 ie unlimited
-            if (width > 0 && chars_read >= width) {
+        // Same as my_scan_each, a format that is all suppressed still makes records
+        if (fields == 0 && stopped != ctx->count) {
+            // Only whitespace was left, that's just the end of the input
+            if (in.pos >= ctx->pending_length) {
+                record_start = ctx->pending_length;
                 break;
             }
+            // Anything else doesn't match the format and we can't resync
+            ctx->failed = 1;
+            free(allocations.results);
+            return EOF;
+        }
+
+        // Matching without reading anything would be the same record forever
+        if (in.pos == record_start) {
+            break;
         }
 
-        c = getchar();
+        record_start = in.pos;
+        records++;
+        if (ctx->callback(ctx->user_data, fields) != 0) {
+            break;
+        }
     }
 
-    // Check if we actually read any hex digits
-    if (digit_count == 0) {
-        return 0;  // Failed - no hex digits found
+    free(allocations.results);
+
+    // Slide the unfinished record to the front of the buffer
+    memmove(ctx->pending, ctx->pending + record_start, ctx->pending_length - record_start);
+    ctx->pending_length -= record_start;
+    return records;
+}
+
+int my_scan_push_feed(my_scan_push *ctx, const char *bytes, size_t length) {
+    if (ctx->failed) {
+        return EOF;
     }
 
-    // Get the pointer (next argument from va_list) where we should store the result and store based on size modifier
-    // Do not store the value if assignment suppression
-    if (!suppress) {
-        if (size_modifier == 'h') {
-            // unsigned short
-            unsigned short *ptr = va_arg(args, unsigned short*);
-            *ptr = (unsigned short)value;
-        } else if (size_modifier == 'H') {
-            // unsigned char (hh modifier - using 'H' to represent)
-            unsigned char *ptr = va_arg(args, unsigned char*);
-            *ptr = (unsigned char)value;
-        } else if (size_modifier == 'l') {
-            // unsigned long
-            unsigned long *ptr = va_arg(args, unsigned long*);
-            *ptr = (unsigned long)value;
-        } else if (size_modifier == 'L') {
-            // unsigned long long (ll modifier - using 'L' to represent)
-            unsigned long long *ptr = va_arg(args, unsigned long long*);
-            *ptr = value;
-        } else {
-            // regular unsigned int (default)
-            unsigned int *ptr = va_arg(args, unsigned int*);
-            *ptr = (unsigned int)value;
+    // Make room for the new bytes after whatever is still pending
+    if (ctx->pending_length + length > ctx->pending_capacity) {
+        size_t capacity = ctx->pending_capacity > 0 ? ctx->pending_capacity * 2 : 256;
+        while (capacity < ctx->pending_length + length) {
+            capacity *= 2;
+        }
+        char *bigger = realloc(ctx->pending, capacity);
+        if (bigger == NULL) {
+            return EOF;
         }
+        ctx->pending = bigger;
+        ctx->pending_capacity = capacity;
     }
 
-    return 1;
+    memcpy(ctx->pending + ctx->pending_length, bytes, length);
+    ctx->pending_length += length;
+
+    return push_records(ctx, 1);
 }
 
-int read_char(const va_list args, int width, int suppress) {
-    if (width == 0) {
-        width = 1;  // Default read 1 character
+int my_scan_push_finish(my_scan_push *ctx) {
+    if (ctx->failed) {
+        return EOF;
     }
+    // No more bytes are coming so the end of the pending bytes really is EOF
+    return push_records(ctx, 0);
+}
 
-    char *dest = NULL;
-    // get the address where the character(s) will be stored
-    if (!suppress) {
-        dest = va_arg(args, char*);
+void my_scan_push_free(my_scan_push *ctx) {
+    if (ctx == NULL) {
+        return;
     }
+    free(ctx->directives);
+    free(ctx->pointers);
+    free(ctx->pending);
+    free(ctx);
+}
 
-    int chars_read = 0;
+// Marks the whitespace and newline bytes of up to 64 bytes of input, bit i is byte i
+void classify_block(const char *block, size_t n, uint64_t *spaces, uint64_t *newlines) {
+    uint64_t space_mask = 0;
+    uint64_t newline_mask = 0;
+    size_t i = 0;
 
-    // Read exactly 'width' characters (or until EOF)
-    for (int i = 0; i < width; i++) {
-        int c = getchar();
+#ifdef __SSE2__
+    // 16 bytes per compare instead of 1, only for full blocks
+    if (n == 64) {
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i four = _mm_set1_epi8(4);
+        const __m128i newline = _mm_set1_epi8('\n');
 
-        if (c == EOF) {
-            // If we hit EOF before reading all requested chars,
-            // scanf fails and returns the count so far
-            break;
+        for (; i < 64; i += 16) {
+            __m128i bytes = _mm_loadu_si128((const __m128i *)(block + i));
+            // '\t' '\n' '\v' '\f' '\r' are the 5 bytes 9 through 13, so byte - '\t' <= 4 (unsigned)
+            __m128i shifted = _mm_sub_epi8(bytes, tab);
+            __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, four), shifted);
+            __m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(bytes, space), is_control);
+
+            space_mask |= (uint64_t)(unsigned)_mm_movemask_epi8(is_space) << i;
+            newline_mask |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)) << i;
         }
+    }
+#endif
 
-        if (!suppress) {
-            dest[chars_read] = (char)c;
+    // Partial blocks (and everything without SSE2) one byte at a time
+    for (; i < n; i++) {
+        unsigned char c = (unsigned char)block[i];
+        if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            space_mask |= (uint64_t)1 << i;
+        }
+        if (c == '\n') {
+            newline_mask |= (uint64_t)1 << i;
         }
-        chars_read++;
     }
 
-    // Return 1 if we read at least 1 character, 0 otherwise
-    return chars_read > 0 ? 1 : 0;
+    *spaces = space_mask;
+    *newlines = newline_mask;
 }
 
-int read_string(const va_list args, int width, int suppress) {
-    int c;
-    int chars_read = 0;
+int my_scan_index_build(my_scan_index *index, const char *data, size_t length) {
+    size_t capacity = 64;
 
-    // Consume all leading whitespace
-    while ((c = getchar()) != EOF && isspace(c)) {}
+    index->data = data;
+    index->length = length;
+    index->space_bits = calloc(length / 64 + 1, sizeof(uint64_t));
+    index->record_starts = malloc(capacity * sizeof(size_t));
+    index->record_count = 0;
 
-    if (c == EOF) {
-        return 0;  // Failed to read anything
+    if (index->space_bits == NULL || index->record_starts == NULL) {
+        my_scan_index_free(index);
+        return 0;
     }
 
-    // Get the pointer where we should store the result
-    // Only get it if we're not suppressing assignment
-    char *dest = NULL;
-    if (!suppress) {
-        dest = va_arg(args, char*);
+    // The first record starts at the beginning of the buffer (unless it is empty)
+    if (length > 0) {
+        index->record_starts[index->record_count++] = 0;
     }
 
-    // Read non-whitespace characters
-    while (c != EOF && !isspace(c)) {
-        // Store the character if not suppressing
-        if (!suppress) {
-            dest[chars_read] = (char)c;
-        }
-        chars_read++;
+    for (size_t block = 0; block < length; block += 64) {
+        size_t n = length - block < 64 ? length - block : 64;
+        uint64_t spaces;
+        uint64_t newlines;
 
-        // Check width limit after each character read in, unless width is 0 ie unlimited
-        if (width > 0 && chars_read >= width) {
-            break;
-        }
+        classify_block(data + block, n, &spaces, &newlines);
+        index->space_bits[block / 64] = spaces;
 
-        c = getchar();
-    }
+        // Every newline starts a new record on the byte after it
+        while (newlines != 0) {
+            size_t start = block + lowest_set_bit(newlines) + 1;
+            // clear the lowest set bit
+            newlines &= newlines - 1;
 
-    // Put back the whitespace character we just read (if not EOF)
-    if (c != EOF && !isspace(c)) {
-        ungetc(c, stdin);
-    }
+            // A newline at the very end does not start an empty record
+            if (start >= length) {
+                break;
+            }
 
-    // Check if we actually read any characters
-    if (chars_read == 0) {
-        return 0;  // Failed - no characters found
+            if (index->record_count == capacity) {
+                capacity *= 2;
+                size_t *bigger = realloc(index->record_starts, capacity * sizeof(size_t));
+                if (bigger == NULL) {
+                    my_scan_index_free(index);
+                    return 0;
+                }
+                index->record_starts = bigger;
+            }
+            index->record_starts[index->record_count++] = start;
+        }
     }
 
-    // Null-terminate the string if not suppressed
-    if (!suppress) {
-        dest[chars_read] = '\0';
+    return 1;
+}
+
+int my_scan_index_record(const my_scan_index *index, size_t record, const char *format, ...) {
+    if (record >= index->record_count) {
+        return EOF;
     }
 
-    return 1;  // Successfully read 1 item
-}
+    // The window only covers this record (including its newline) so a failed
+    // conversion can never run into the next record
+    size_t end = record + 1 < index->record_count ? index->record_starts[record + 1] : index->length;
+    scan_input in = {NULL, index->data, index->record_starts[record], end, index->space_bits, NULL, NULL, 0, 0, 0, {0}};
 
-// UNSIGNED binary numbers
-int read_binary(const va_list args, int width, char size_modifier, int suppress) {
-    int c;
-    unsigned long long value = 0;
-    int digit_count = 0;
-    int chars_read = 0;
+    va_list list;
+    va_start(list, format);
 
-    // Consume all leading whitespace
-    while ((c = getchar()) != EOF && isspace(c)) {}
+    scan_args args = {&list, NULL, 0};
+    int result = parse_format_string(&in, format, &args, NULL);
 
-    if (c == EOF) {
-        return 0;  // Failed to read anything
-    }
+    va_end(list);
+    return result;
+}
 
-    // Handle 0b or 0B prefix (optional)
-    if (c == '0') {
-        chars_read++;
+void my_scan_index_free(my_scan_index *index) {
+    free(index->space_bits);
+    free(index->record_starts);
+    index->space_bits = NULL;
+    index->record_starts = NULL;
+    index->record_count = 0;
+}
 
-        // Check if we've hit width limit after just the '0'
-        if (width > 0 && chars_read >= width) {
-            // Just read a '0', treat it as a binary digit
-            value = 0;
-            digit_count = 1;
-            // Continue to store the value below
-        } else {
-            // We can still read more, check for 'b' or 'B'
-            int next = getchar();
-            if (next == 'b' || next == 'B') {
-                // 0b prefix found, this counts toward width
-                chars_read++;
+// One node of the trie over the formats' leading literal characters
+typedef struct {
+    char c;
+    int child;       // first node one character further in, -1 if none
+    int sibling;     // next node under the same parent, -1 if none
+    uint64_t ends;   // formats whose whole literal prefix ends at this node
+} any_node;
 
-                // Check width limit after the prefix
-                if (width > 0 && chars_read >= width) {
-                    return 0;  // No binary digits read, just "0b"
-                }
+// Everything my_scan_any builds from a set of formats, kept per thread between calls
+typedef struct {
+    char **formats;                  // copy of the set this was built for, the caller's array may be reused
+    int n;
+    format_directive **directives;   // each format parsed once
+    int *counts;
+    int *prefixes;                   // leading literal directives of each format, matched by the trie
+    int *field_offsets;              // where each format's pointers start in the arguments
+    void **pointers;
+    any_node *nodes;                 // node 0 is the root, the empty prefix
+    int node_count;
+    char *line;                      // the record being dispatched
+    size_t line_capacity;
+} any_dispatch;
 
-                // Continue reading binary digits
-                c = getchar();
-            } else {
-                // Just a leading 0, process it as a binary digit
-                ungetc(next, stdin);
-                value = 0;
-                digit_count = 1;
-                c = getchar();
-            }
+SCAN_THREAD_LOCAL any_dispatch *current_dispatch = NULL;
+
+void free_dispatch(any_dispatch *dispatch) {
+    if (dispatch == NULL) {
+        return;
+    }
+    for (int k = 0; k < dispatch->n; k++) {
+        if (dispatch->formats != NULL) {
+            free(dispatch->formats[k]);
+        }
+        if (dispatch->directives != NULL) {
+            free(dispatch->directives[k]);
         }
     }
+    free(dispatch->formats);
+    free(dispatch->directives);
+    free(dispatch->counts);
+    free(dispatch->prefixes);
+    free(dispatch->field_offsets);
+    free(dispatch->pointers);
+    free(dispatch->nodes);
+    free(dispatch->line);
+    free(dispatch);
+}
 
-    // Read binary digits (0 or 1)
-    while (c != EOF) {
-        if (c == '0' || c == '1') {
-            // Same conversion logic but in base 2
-            value = value * 2 + (c - '0');
-            digit_count++;
-            chars_read++;
+// Parses every format and puts their literal prefixes in the trie
+// Returns NULL if memory could not be allocated
+any_dispatch *build_dispatch(const char *const *formats, int n) {
+    any_dispatch *dispatch = calloc(1, sizeof(any_dispatch));
+    if (dispatch == NULL) {
+        return NULL;
+    }
+    dispatch->n = n;
+    dispatch->formats = calloc(n, sizeof(char *));
+    dispatch->directives = calloc(n, sizeof(format_directive *));
+    dispatch->counts = calloc(n, sizeof(int));
+    dispatch->prefixes = calloc(n, sizeof(int));
+    dispatch->field_offsets = calloc(n, sizeof(int));
+    if (dispatch->formats == NULL || dispatch->directives == NULL || dispatch->counts == NULL ||
+        dispatch->prefixes == NULL || dispatch->field_offsets == NULL) {
+        free_dispatch(dispatch);
+        return NULL;
+    }
 
-            // Check width limit
-            if (width > 0 && chars_read >= width) {
-                break;
-            }
+    int total_fields = 0;
+    int total_prefix = 0;
+    for (int k = 0; k < n; k++) {
+        dispatch->formats[k] = malloc(strlen(formats[k]) + 1);
+        if (dispatch->formats[k] == NULL) {
+            free_dispatch(dispatch);
+            return NULL;
+        }
+        strcpy(dispatch->formats[k], formats[k]);
 
-            c = getchar();
-        } else {
-            // Not a binary digit, put it back
-            ungetc(c, stdin);
-            break;
+        dispatch->directives[k] = compile_format(formats[k], &dispatch->counts[k]);
+        if (dispatch->directives[k] == NULL) {
+            free_dispatch(dispatch);
+            return NULL;
         }
+        // Literal characters before the first whitespace or conversion
+        int prefix = 0;
+        while (prefix < dispatch->counts[k] && dispatch->directives[k][prefix].kind == 'l') {
+            prefix++;
+        }
+        dispatch->prefixes[k] = prefix;
+        total_prefix += prefix;
+
+        dispatch->field_offsets[k] = total_fields;
+        total_fields += count_fields(dispatch->directives[k], dispatch->counts[k]);
     }
 
-    // Check if we actually read any binary digits
-    if (digit_count == 0) {
-        return 0;  // Failed - no binary digits found
+    dispatch->pointers = malloc((total_fields + 1) * sizeof(void *));
+    dispatch->nodes = malloc((total_prefix + 1) * sizeof(any_node));
+    if (dispatch->pointers == NULL || dispatch->nodes == NULL) {
+        free_dispatch(dispatch);
+        return NULL;
     }
 
-    // Store the value based on size modifier (if not suppressed)
-    if (!suppress) {
-        if (size_modifier == 'h') {
-            unsigned short *ptr = va_arg(args, unsigned short*);
-            *ptr = (unsigned short)value;
-        } else if (size_modifier == 'H') {
-            unsigned char *ptr = va_arg(args, unsigned char*);
-            *ptr = (unsigned char)value;
-        } else if (size_modifier == 'l') {
-            unsigned long *ptr = va_arg(args, unsigned long*);
-            *ptr = (unsigned long)value;
-        } else if (size_modifier == 'L') {
-            unsigned long long *ptr = va_arg(args, unsigned long long*);
-            *ptr = value;
-        } else {
-            unsigned int *ptr = va_arg(args, unsigned int*);
-            *ptr = (unsigned int)value;
+    dispatch->nodes[0] = (any_node){'\0', -1, -1, 0};
+    dispatch->node_count = 1;
+    for (int k = 0; k < n; k++) {
+        int node = 0;
+        for (int p = 0; p < dispatch->prefixes[k]; p++) {
+            char c = dispatch->directives[k][p].literal;
+            int child = dispatch->nodes[node].child;
+            while (child >= 0 && dispatch->nodes[child].c != c) {
+                child = dispatch->nodes[child].sibling;
+            }
+            if (child < 0) {
+                // First format with this prefix, add the node
+                child = dispatch->node_count++;
+                dispatch->nodes[child] = (any_node){c, -1, dispatch->nodes[node].child, 0};
+                dispatch->nodes[node].child = child;
+            }
+            node = child;
         }
+        dispatch->nodes[node].ends |= 1ULL << k;
     }
 
-    return 1;  // Successfully read 1 item
+    return dispatch;
 }
 
-int read_boolean(const va_list args, int width, int suppress) {
-    int c;
-    int chars_read = 0;
-    int bool_value = -1;  // -1 means undetermined
-
-    // Consume all leading whitespace
-    while ((c = getchar()) != EOF && isspace(c)) {}
+// Whether dispatch was built for these formats, compared by their text
+// so an array that's reused for other formats isn't mistaken for the old set
+int same_formats(const any_dispatch *dispatch, const char *const *formats, int n) {
+    if (dispatch == NULL || dispatch->n != n) {
+        return 0;
+    }
+    for (int k = 0; k < n; k++) {
+        if (strcmp(dispatch->formats[k], formats[k]) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
 
-    if (c == EOF) {
-        return 0;  // Failed to read anything
+// Cheap check that the first conversion after the literal prefix can start at line[pos],
+// so formats that can't match are skipped without running them
+int could_start(const format_directive *directives, int count, const char *line, size_t pos, size_t length) {
+    if (count > 0 && directives->kind == 'w') {
+        directives++;
+        count--;
+    }
+    if (count == 0 || directives->kind != '%' || directives->suppress) {
+        return 1;  // Nothing to check
     }
 
-    // Convert first character to lowercase for comparison
-    int first_char = tolower(c);
-    chars_read++;
+    // The numeric conversions skip whitespace first
+    while (pos < length && isspace((unsigned char)line[pos])) {
+        pos++;
+    }
+    int c = pos < length ? (unsigned char)line[pos] : EOF;
+    int sign = c == '+' || c == '-';
 
-    if (first_char == '1') {
-        bool_value = 1;
-    } else if (first_char == '0') {
-        bool_value = 0;
-    } else if (first_char == 't' || first_char == 'y') {
-        // Might be "true" or "yes", but accept just "t" or "y"
-        bool_value = 1;
+    switch (directives->specifier) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'D':
+            return c != EOF && (isdigit(c) || sign || (directives->specifier == 'D' && c == '.'));
+        case 'o':
+            return c != EOF && (digit_value[c] < 8 || sign);
+        case 'x':
+        case 'X':
+            return c != EOF && (digit_value[c] < 16 || sign);
+        case 'f':
+        case 'a':
+        case 'A':
+            return c != EOF && (isdigit(c) || sign || c == '.');
+        case 'T':
+        case 'I':
+            return c != EOF && isdigit(c);
+        default:
+            return 1;
+    }
+}
 
-        // Try to read more characters if width allows
-        if (width == 0 || chars_read < width) {
-            // Peek at next character to see if it continues the word
-            int next = getchar();
-            if (next != EOF) {
-                int next_lower = tolower(next);
-                // Check if it's part of "true" or "yes"
-                if ((first_char == 't' && next_lower == 'r') ||
-                    (first_char == 'y' && next_lower == 'e')) {
-                    // Continue reading the rest of the word
-                    chars_read++;
-                    while ((width == 0 || chars_read < width)) {
-                        next = getchar();
-                        if (next == EOF || isspace(next) || !isalpha(next)) {
-                            if (next != EOF) {
-                                ungetc(next, stdin);
-                            }
-                            break;
-                        }
-                        chars_read++;
-                    }
-                } else {
-                    // Not part of a boolean word, put it back
-                    ungetc(next, stdin);
-                }
-            }
-        }
-    } else if (first_char == 'f' || first_char == 'n') {
-        // Might be "false" or "no", but accept just "f" or "n"
-        bool_value = 0;
+int my_scan_any(const char *const formats[], int n, int *which, ...) {
+    *which = -1;
 
-        // Try to read more characters if width allows
-        if (width == 0 || chars_read < width) {
-            int next = getchar();
-            if (next != EOF) {
-                int next_lower = tolower(next);
-                if ((first_char == 'f' && next_lower == 'a') ||
-                    (first_char == 'n' && next_lower == 'o')) {
-                    // Continue reading the rest of the word
-                    chars_read++;
-                    while ((width == 0 || chars_read < width)) {
-                        next = getchar();
-                        if (next == EOF || isspace(next) || !isalpha(next)) {
-                            if (next != EOF) {
-                                ungetc(next, stdin);
-                            }
-                            break;
-                        }
-                        chars_read++;
-                    }
-                } else {
-                    ungetc(next, stdin);
-                }
-            }
-        }
-    } else {
-        // Unrecognized boolean format
-        ungetc(c, stdin);
+    // The trie keeps one bit per format
+    if (n <= 0 || n > 64) {
         return 0;
     }
 
-    // Store the boolean value (if not suppressed)
-    if (!suppress) {
-        int *ptr = va_arg(args, int*);
-        *ptr = bool_value;
+    if (!same_formats(current_dispatch, formats, n)) {
+        free_dispatch(current_dispatch);
+        current_dispatch = build_dispatch(formats, n);
+        if (current_dispatch == NULL) {
+            return EOF;
+        }
     }
+    any_dispatch *dispatch = current_dispatch;
 
-    return 1;
-}
+    // All the pointers up front, the formats that don't match skip theirs
+    int total_fields = dispatch->field_offsets[n - 1] +
+                       count_fields(dispatch->directives[n - 1], dispatch->counts[n - 1]);
+    va_list list;
+    va_start(list, which);
+    for (int f = 0; f < total_fields; f++) {
+        dispatch->pointers[f] = va_arg(list, void *);
+    }
+    va_end(list);
 
-int read_line(const va_list args, int width, int suppress) {
+    // Read the whole record so every candidate can start over from the beginning of it
+    size_t length = 0;
     int c;
-    int chars_read = 0;
-
-    // NOTE: Unlike %s, this does NOT skip leading whitespace
-    // It reads everything up to (but not including) the newline
+    lock_stream(stdin);
+    while ((c = getc(stdin)) != EOF) {
+        if (length == dispatch->line_capacity) {
+            size_t capacity = dispatch->line_capacity > 0 ? dispatch->line_capacity * 2 : 256;
+            char *line = realloc(dispatch->line, capacity);
+            if (line == NULL) {
+                unlock_stream(stdin);
+                return EOF;
+            }
+            dispatch->line = line;
+            dispatch->line_capacity = capacity;
+        }
+        dispatch->line[length++] = (char)c;
+        if (c == '\n') {
+            break;
+        }
+    }
+    unlock_stream(stdin);
 
-    // Get the pointer where we should store the result
-    char *dest = NULL;
-    if (!suppress) {
-        dest = va_arg(args, char*);
+    if (length == 0) {
+        return EOF;
     }
 
-    // Read characters until newline or EOF
-    while ((c = getchar()) != EOF && c != '\n') {
-        // Store the character if not suppressing
-        if (!suppress) {
-            dest[chars_read] = (char)c;
+    // Walk the trie down the line, every node passed ends the prefix of some formats
+    uint64_t candidates = dispatch->nodes[0].ends;
+    int node = 0;
+    for (size_t i = 0; i < length; i++) {
+        int child = dispatch->nodes[node].child;
+        while (child >= 0 && dispatch->nodes[child].c != dispatch->line[i]) {
+            child = dispatch->nodes[child].sibling;
         }
-        chars_read++;
-
-        // Check width limit after each character read in, unless width is 0 ie unlimited
-        if (width > 0 && chars_read >= width) {
+        if (child < 0) {
             break;
         }
+        node = child;
+        candidates |= dispatch->nodes[node].ends;
     }
 
+    // Try them in the order they were given, the prefix already matched
+    while (candidates != 0) {
+        int k = lowest_set_bit(candidates);
+        candidates &= candidates - 1;
 
-    // The newline terminates the line and IS consumed by the read
-    if (c == '\n') {
-        // Just let it be consumed (already read by getchar)
-    } // If we stopped due to width limit, put back the character
-    else if (c != EOF) {
-        ungetc(c, stdin);
-    }
+        const format_directive *rest = dispatch->directives[k] + dispatch->prefixes[k];
+        int rest_count = dispatch->counts[k] - dispatch->prefixes[k];
+        size_t start = dispatch->prefixes[k];
+        if (!could_start(rest, rest_count, dispatch->line, start, length)) {
+            continue;
+        }
 
-    // Null-terminate the string if not suppressed
-    if (!suppress) {
-        dest[chars_read] = '\0';
+        scan_input in = {NULL, dispatch->line, start, length, NULL, NULL, NULL, 0, 0, 0, {0}};
+        scan_args args = {NULL, dispatch->pointers + dispatch->field_offsets[k], 0};
+        int stopped;
+        int result = run_directives(&in, rest, rest_count, &args, &stopped);
+        // It has to match all of the line, only whitespace (the newline) may be left over
+        if (stopped == rest_count && skip_whitespace(&in) == EOF) {
+            *which = k;
+            return result;
+        }
     }
 
-    // Return success if we read at least one character OR hit a newline
-    // (even an empty line should count as success)
-    return (chars_read > 0 || c == '\n') ? 1 : 0;
+    return 0;
 }
 
-int parse_format_string(const char *format, va_list args) {
-    int successful = 0;
-    int i = 0;
+void my_scan_any_free(void) {
+    free_dispatch(current_dispatch);
+    current_dispatch = NULL;
+}
 
-    while (format[i] != '\0') {
-        // Check for literal characters or whitespace
-        if (format[i] != '%') {
-            // Consume any amount of whitespace from input stream
-            if (isspace(format[i])) {
-                int c;
-                while ((c = getchar()) != EOF && isspace(c)) {
-                }
-                // When you find a non whitespace character return it to the stream
-                // so it can be read by the next format specifier
-                if (c != EOF) {
-                    ungetc(c, stdin);
-                }
-                // Move to the next character in the format string
-                i++;
-                continue;
-            }
+// Checks one line (with its newline, so %N on an empty line finds it) for my_scan_validate
+// Returns 1 if it matches, otherwise fills in where it stopped
+int validate_line(const char *line, size_t length, const format_directive *directives, int count,
+                  size_t *stop, int *stopped) {
+    scan_input in = {NULL, line, 0, length, NULL, NULL, NULL, 0, 0, 0, {0}};
+    scan_args args = {NULL, NULL, 0};
 
-            // Match literal characters exactly
-            int c = getchar();
-            if (c != format[i]) {
-                // Mismatch - matching failure
-                if (c != EOF) {
-                    ungetc(c, stdin);
-                }
-                return successful;
-            }
-            // Move to the next character in the format string
-            i++;
-            continue;
+    run_directives(&in, directives, count, &args, stopped);
+    if (*stopped == count) {
+        // Only whitespace (like the \r\n or \n the line ends with) may be left over
+        int c = skip_whitespace(&in);
+        if (c == EOF) {
+            return 1;
         }
-        // At this point we have a '%' so see what follows it to determine which format specifier to use
-        i++;
+        unread_char(&in, c);
+    }
+    *stop = in.pos;
+    return 0;
+}
 
-        // Check for '%%' (literal %)
-        if (format[i] == '%') {
-            int c = getchar();
-            // If you didn't find the literal % in the input stream, return immediately
-            if (c != '%') {
-                if (c != EOF) {
-                    ungetc(c, stdin);
-                }
-                return successful;
-            }
-            i++;
-            continue;
-        }
+int my_scan_validate(FILE *source, const char *format, my_scan_report *report) {
+    int count;
+    format_directive *directives = compile_format(format, &count);
+    size_t capacity = SCAN_WINDOW_SIZE;
+    char *buffer = malloc(capacity);
 
-        // Check for assignment suppression '*'
-        // Will read from the input stream, but not store the value
-        int suppress = 0;
-        if (format[i] == '*') {
-            suppress = 1;
-            i++;
-        }
+    if (directives == NULL || buffer == NULL) {
+        free(directives);
+        free(buffer);
+        return EOF;
+    }
 
-        // Parse width (optional modifier)
-        int width = 0;
-        // if there is a digit following the % it is a width modifier
-        // if no digit the loop doesn't run so width stays at 0 meaning unlimited
-        while (isdigit(format[i])) {
-            // Convert string numbers to values
-            // ascii value of the number - the ascii value of 0 = the number
-            // * 10 to account for the place when a new digit is added to the right
-            width = width * 10 + (format[i] - '0');
-            i++;
+    // Everything runs suppressed, so nothing ever asks for a field pointer
+    for (int d = 0; d < count; d++) {
+        if (directives[d].kind == '%' || directives[d].kind == '{') {
+            directives[d].suppress = 1;
         }
+    }
 
-        // Parse size modifier (h, hh, l, ll, L)
-        char size_modifier = '\0';
-        if (format[i] == 'h') {
-            i++;
-            if (format[i] == 'h') {
-                size_modifier = 'H';  // hh
-                i++;
-            } else {
-                size_modifier = 'h';  // h
-            }
-        } else if (format[i] == 'l') {
-            i++;
-            if (format[i] == 'l') {
-                size_modifier = 'L';  // ll
-                i++;
-            } else {
-                size_modifier = 'l';  // l
+    if (report != NULL) {
+        report->lines = 0;
+        report->violation_count = 0;
+    }
+
+    size_t lines = 0;
+    size_t violations = 0;
+    size_t buffer_offset = 0;  // of buffer[0] in the source
+    size_t length = 0;
+    int at_end = 0;
+
+    // Nobody else gets to touch the stream until we're done with it
+    lock_stream(source);
+
+    while (!at_end) {
+        // Top the buffer up, it starts with the unfinished line of the last round
+        // and has to grow when a single line doesn't fit in it
+        if (length == capacity) {
+            char *bigger = realloc(buffer, capacity * 2);
+            if (bigger == NULL) {
+                unlock_stream(source);
+                free(directives);
+                free(buffer);
+                return EOF;
             }
-        } else if (format[i] == 'L') {
-            size_modifier = 'L';  // long double (for %f)
-            i++;
+            buffer = bigger;
+            capacity *= 2;
         }
+        size_t got = fread(buffer + length, 1, capacity - length, source);
+        length += got;
+        at_end = got == 0;
 
-        // Determine which format specifier to use
-        char specifier = format[i];
-        int success = 0;
-
-        switch (specifier) {
-            case 'd':
-                success = read_int(args, width, size_modifier, suppress);
-                break;
-            case 'f':
-                success = read_float(args, width, size_modifier, suppress);
-                break;
-            case 'x':
-            case 'X':
-                success = read_hex(args, width, size_modifier, suppress);
-                break;
-            case 'c':
-                success = read_char(args, width, suppress);
-                break;
-            case 's':
-                success = read_string(args, width, suppress);
-                break;
-            case 'b':
-                success = read_binary(args, width, size_modifier, suppress);
-                break;
-            case 'B':
-                success = read_boolean(args, width, suppress);
-                break;
-            case 'N':
-                success = read_line(args, width, suppress);
+        // Every finished line, and at the end of the source the last one even without a newline
+        size_t start = 0;
+        while (start < length) {
+            const char *newline = memchr(buffer + start, '\n', length - start);
+            size_t end = newline != NULL ? (size_t)(newline - buffer) : length;
+            if (newline == NULL && !at_end) {
                 break;
+            }
 
-            default:
-                // Unknown format specifier fails and returns however many successful conversions have occurred up to this point
-                    return successful;
+            lines++;
+            size_t stop;
+            int stopped;
+            size_t line_length = end - start + (newline != NULL ? 1 : 0);
+            if (!validate_line(buffer + start, line_length, directives, count, &stop, &stopped)) {
+                if (report != NULL && violations < MY_SCAN_REPORT_SIZE) {
+                    my_scan_violation *violation = &report->violations[violations];
+                    violation->line = lines;
+                    violation->offset = buffer_offset + start + stop;
+                    violation->directive = stopped;
+                }
+                violations++;
+            }
+            start = end + 1;
         }
 
-        // If we successfully read something, and it's not suppressed, increment count
-        if (success && !suppress) {
-            successful++;
-        } else if (!success) {
-            // Matching failure - return current count
-            return successful;
+        // Keep the unfinished line for the next round
+        if (start > length) {
+            start = length;
         }
-
-        i++;
+        memmove(buffer, buffer + start, length - start);
+        buffer_offset += start;
+        length -= start;
     }
 
-    return successful;
-}
-
-int my_scanf(const char *format, ...) {
-    va_list args;
-    va_start(args, format);
-
-    int result = parse_format_string(format, args);
+    unlock_stream(source);
+    free(directives);
+    free(buffer);
 
-    va_end(args);
-    return result;
+    if (report != NULL) {
+        report->lines = lines;
+        report->violation_count = violations;
+    }
+    return violations > INT_MAX ? INT_MAX : (int)violations;
 }
@@ -0,0 +1,208 @@
+#ifndef MY_SCANF_H
+#define MY_SCANF_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Reads from stdin according to format, returns the number of successful conversions
+int my_scanf(const char *format, ...);
+
+// Why my_scanf_ex stopped
+typedef enum {
+    MY_SCAN_COMPLETE,          // the whole format matched
+    MY_SCAN_FAILED_EOF,        // the input ended (or a read error) before the format did
+    MY_SCAN_FAILED_MISMATCH,   // the input didn't match a directive
+    MY_SCAN_FAILED_OVERFLOW    // a number didn't fit its variable with MY_SCAN_OVERFLOW_FAIL
+} my_scan_failure;
+
+typedef struct {
+    int conversions;           // same as the return value
+    size_t consumed;           // bytes read and not put back, where the next call carries on
+    size_t line;               // of the first byte not consumed, from 1 where the call started
+    size_t column;             // the same, counting bytes from 1
+    int directive;             // index of the directive that failed, -1 if none did. Every
+                               // conversion, %{ %| %}, run of whitespace and literal
+                               // character in format is one
+    my_scan_failure failure;
+} my_scan_result;
+
+// Same as my_scanf and also tells how far it got and why it stopped
+// The position is counted as characters are taken from stdin and worked out once at the end,
+// it stays right however many characters (newlines too) a failed group put back
+int my_scanf_ex(my_scan_result *result, const char *format, ...);
+
+// What an integer conversion (%d %i %u %o %x %b) does when the number doesn't fit in its variable
+typedef enum {
+    MY_SCAN_OVERFLOW_WRAP,      // keep the low bits, the default
+    MY_SCAN_OVERFLOW_SATURATE,  // store the largest (or smallest) value that fits
+    MY_SCAN_OVERFLOW_FAIL       // matching failure, nothing is stored
+} my_scan_overflow;
+
+// Sets the overflow policy for conversions on this thread
+void my_scan_set_overflow(my_scan_overflow policy);
+
+// Number of conversions that overflowed during the last call on this thread
+// (for my_scan_each and the push parser, during the last record)
+int my_scan_overflowed(void);
+
+// How %D drops the digits past its precision, %.2D of 1.235 is 123 when truncating
+// and 124 rounding half up or half even (1.225 is 123 with half up, 122 with half even)
+typedef enum {
+    MY_SCAN_ROUND_TRUNCATE,    // drop them, the default
+    MY_SCAN_ROUND_HALF_UP,     // ties go away from zero
+    MY_SCAN_ROUND_HALF_EVEN    // ties go to the even value
+} my_scan_rounding;
+
+// Sets the rounding for %D conversions on this thread
+void my_scan_set_rounding(my_scan_rounding rounding);
+
+// How %Z treats the '=' padding at the end of base64
+typedef enum {
+    MY_SCAN_BASE64_LENIENT,    // padding is optional, the default
+    MY_SCAN_BASE64_STRICT      // padding is required and unused bits must be 0
+} my_scan_base64;
+
+// Sets the base64 padding mode for %Z conversions on this thread
+void my_scan_set_base64(my_scan_base64 mode);
+
+// Storage for the %m conversions (%ms, %mc, %mN, %mZ), which take a char** and allocate the string
+// Strings are carved off a block of memory one after another and my_scan_arena_reset
+// releases all of them at once. If the memory runs out strings are malloc'd instead
+// and freed by the reset too
+typedef struct my_scan_arena_block my_scan_arena_block;
+
+typedef struct {
+    char *memory;
+    size_t size;
+    size_t used;
+    my_scan_arena_block *overflow;  // strings that didn't fit in memory
+} my_scan_arena;
+
+void my_scan_arena_init(my_scan_arena *arena, void *memory, size_t size);
+void my_scan_arena_reset(my_scan_arena *arena);
+
+// Makes %m conversions on this thread allocate from arena
+// With NULL (the default) every string is malloc'd on its own and the caller frees it
+void my_scan_set_arena(my_scan_arena *arena);
+
+// Table of distinct strings for %ks conversions, which take a const char** and store a pointer
+// to the one copy the table keeps of each string. Only the first occurrence is copied, so
+// fields that repeat a lot (status codes, hostnames) cost nothing after that and can be
+// compared by pointer
+typedef struct my_scan_intern_slot my_scan_intern_slot;
+
+typedef struct {
+    my_scan_intern_slot *slots;  // open addressing, always a power of 2 of them
+    size_t capacity;
+    size_t count;                // distinct strings stored
+    my_scan_arena storage;       // the strings themselves
+    char *scratch;               // token being read before we know if it's new
+    size_t scratch_capacity;
+} my_scan_intern;
+
+void my_scan_intern_init(my_scan_intern *table);
+void my_scan_intern_free(my_scan_intern *table);
+
+// Makes %ks conversions on this thread use table, %ks fails while none is set
+void my_scan_set_intern(my_scan_intern *table);
+
+// Called by my_scan_each after every record with the number of fields converted
+// The fields themselves are in the variables that were passed to my_scan_each
+// Return 0 to keep going or anything else to stop
+typedef int (*my_scan_callback)(void *user_data, int fields);
+
+// Applies format to stream over and over until EOF (or a record that doesn't match at all),
+// calling callback after each record. A record either matches the whole format or converts
+// at least one field, so formats with only suppressed conversions work too. The format is
+// parsed once and the stream stays locked for the whole run. Pass the field pointers after
+// user_data like with my_scanf
+// The stream is read in large blocks. What was read past the last record is handed back
+// with fseek, so on a stream that can't seek (a pipe or terminal) those bytes are lost
+// and the stream can't be read any further after this
+// Returns the number of records passed to the callback, or EOF if memory could not be allocated
+int my_scan_each(FILE *stream, const char *format, my_scan_callback callback, void *user_data, ...);
+
+// Incremental (push) parser for input that arrives in pieces, eg from a non blocking socket
+// Records may be split anywhere, even in the middle of a number, bytes of an unfinished
+// record are kept until the rest of it is fed in
+typedef struct my_scan_push my_scan_push;
+
+// Parses format once and remembers the field pointers passed after user_data,
+// callback is called with them filled in after every finished record
+// Returns NULL if memory could not be allocated
+my_scan_push *my_scan_push_create(const char *format, my_scan_callback callback, void *user_data, ...);
+
+// Adds length bytes to the input and calls the callback for every record they finish
+// Returns the number of records finished, or EOF if the input stopped matching the format
+// (the context can't be used after that)
+int my_scan_push_feed(my_scan_push *ctx, const char *bytes, size_t length);
+
+// Marks the end of the input and finishes the last record if there is one
+int my_scan_push_finish(my_scan_push *ctx);
+
+void my_scan_push_free(my_scan_push *ctx);
+
+// Stage 1 index over a large buffer of records (one record per line)
+// Every whitespace byte is marked in a bitmap and the start of every line is recorded,
+// so converting a record later never has to look at the separators again
+typedef struct {
+    const char *data;        // buffer that was indexed, not copied so it must outlive the index
+    size_t length;
+    uint64_t *space_bits;    // 1 bit per byte of data, set when the byte is whitespace
+    size_t *record_starts;   // offset of the first byte of every record
+    size_t record_count;
+} my_scan_index;
+
+// Builds the index, returns 1 on success or 0 if memory could not be allocated
+int my_scan_index_build(my_scan_index *index, const char *data, size_t length);
+
+// Stage 2: converts one record of an indexed buffer like my_scanf would
+// Returns the number of successful conversions, or EOF if the record does not exist
+// The index is only read so different records can be converted from different threads
+int my_scan_index_record(const my_scan_index *index, size_t record, const char *format, ...);
+
+void my_scan_index_free(my_scan_index *index);
+
+// Reads one line from stdin and converts it with the first of formats[0..n-1] that matches
+// all of it, for logs with several kinds of lines. The field pointers of every format are
+// passed one format after another. *which gets the index of the format used, -1 if none
+// Formats are only tried when their leading literal text starts the line, found with a
+// prefix trie that's built once per thread for the formats (at most 64 of them) and reused
+// while the same formats are passed (compared by their text, the array can be reused).
+// Only whitespace may be left on the line after a format's last directive. A format that
+// fails part way, or leaves text over, may already have stored some of its fields
+// Returns the number of successful conversions, 0 if no format matched or EOF at the end of input
+int my_scan_any(const char *const formats[], int n, int *which, ...);
+
+// Releases the trie and formats my_scan_any keeps for this thread
+void my_scan_any_free(void);
+
+// Most violations a my_scan_report keeps the details of
+#define MY_SCAN_REPORT_SIZE 16
+
+// Where a line failed to match, see my_scan_validate
+typedef struct {
+    size_t line;       // counting from 1
+    size_t offset;     // of the byte where matching stopped, counted from where the source
+                       // was when validation started
+    int directive;     // index of the directive that failed, one past the last one for
+                       // extra text at the end of the line
+} my_scan_violation;
+
+typedef struct {
+    size_t lines;                                      // lines checked
+    size_t violation_count;                            // lines that don't match, all of them
+    my_scan_violation violations[MY_SCAN_REPORT_SIZE]; // the first ones of them
+} my_scan_report;
+
+// Checks that every line of source matches all of format without converting anything:
+// every conversion runs as if it had a *, so fields still have to have the right shape
+// (digits for %d, a valid date for %T and so on, with MY_SCAN_OVERFLOW_FAIL numbers have
+// to fit their variable) but nothing is stored or allocated and no field pointers are
+// passed. Text after the last directive other than whitespace is a violation too.
+// report can be NULL when only the count matters
+// Returns the number of lines that don't match, or EOF if memory could not be allocated
+int my_scan_validate(FILE *source, const char *format, my_scan_report *report);
+
+#endif
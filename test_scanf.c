@@ -1,9 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <float.h>
 
-// Forward declaration of function, my_scanf exists but not defined here
-int my_scanf(const char *format, ...);
+// Declarations of my_scanf and the other entry points, defined in my_scanf.c
+#include "my_scanf.h"
 
 int tests_passed = 0;
 int tests_failed = 0;
@@ -109,6 +111,13 @@ void prepare_test_input_multiline(const char *test_data_file, int start_line, in
 
 
 
+// Counts the records my_scan_each hands back without looking at them
+int count_record(void *user_data, int fields) {
+    (void)fields;
+    (*(int *)user_data)++;
+    return 0;
+}
+
 /* ============= Format of Test =============
     1. Get the data from correct line of input file and write to temp file
     2. Redirect stdin to read from the temp file NOT keyboard
@@ -352,6 +361,199 @@ void test_suppress_assignment() {
         tests_failed++;
     }
 }
+void test_integer_overflow() {
+    long long big;
+    signed char tiny;
+    unsigned char byte;
+
+    printf("Running test: Overflow wraps by default\n");
+    prepare_test_input("test_data.txt", 102, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%*d %hhd", &tiny);
+    int overflowed = my_scan_overflowed();
+    restore_stdin(orig_stdin);
+    if (result == 1 && tiny == 127 && overflowed == 2) {
+        printf("   PASSED - Value: %d (%d overflows)\n", tiny, overflowed);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 127 with 2 overflows; got %d, %d (return: %d)\n", tiny, overflowed, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Overflow saturates\n");
+    my_scan_set_overflow(MY_SCAN_OVERFLOW_SATURATE);
+    prepare_test_input("test_data.txt", 102, "temp_input.txt");
+    orig_stdin = setup_input_from_file("temp_input.txt");
+    result = my_scanf("%lld %hhd %hhx", &big, &tiny, &byte);
+    overflowed = my_scan_overflowed();
+    restore_stdin(orig_stdin);
+    if (result == 3 && big == LLONG_MAX && tiny == -128 && byte == 255 && overflowed == 3) {
+        printf("   PASSED - Values: %lld, %d, %u\n", big, tiny, byte);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected %lld, -128, 255; got %lld, %d, %u (return: %d)\n", LLONG_MAX, big, tiny, byte, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Overflow fails\n");
+    my_scan_set_overflow(MY_SCAN_OVERFLOW_FAIL);
+    big = 5;
+    prepare_test_input("test_data.txt", 102, "temp_input.txt");
+    orig_stdin = setup_input_from_file("temp_input.txt");
+    result = my_scanf("%lld", &big);
+    overflowed = my_scan_overflowed();
+    restore_stdin(orig_stdin);
+    if (result == 0 && big == 5 && overflowed == 1) {
+        printf("   PASSED - Return: %d, Value unchanged: %lld\n", result, big);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected return 0 with 5 unchanged; got %d, %lld\n", result, big);
+        tests_failed++;
+    }
+
+    printf("Running test: Overflow fails from memory\n");
+    const char *data = "0x1ffffffffffffffff 0b11111111111111111111111111111111111111111111111111111111111111111\n";
+    unsigned long long wide = 5;
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    int result1 = my_scan_index_record(&index, 0, "%llx", &wide);
+    int result2 = my_scan_index_record(&index, 0, "%*s %llb", &wide);
+    my_scan_index_free(&index);
+    my_scan_set_overflow(MY_SCAN_OVERFLOW_WRAP);
+    if (result1 == 0 && result2 == 0 && wide == 5) {
+        printf("   PASSED - Returns: %d, %d\n", result1, result2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 0, 0 with 5 unchanged; got %d, %d, %llu\n", result1, result2, wide);
+        tests_failed++;
+    }
+}
+
+void test_radix_conversions() {
+    unsigned int u, o, minus;
+    int i1, i2, i3, i4;
+
+    printf("Running test: Unsigned, octal and prefixed integers\n");
+    prepare_test_input("test_data.txt", 103, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%u %o %u %i %i %i %i", &u, &o, &minus, &i1, &i2, &i3, &i4);
+    restore_stdin(orig_stdin);
+    if (result == 7 && u == 4294967295u && o == 0755 && minus == UINT_MAX &&
+        i1 == 0x1F && i2 == 017 && i3 == 5 && i4 == -42) {
+        printf("   PASSED - Values: %u, %o, %u, %d, %d, %d, %d\n", u, o, minus, i1, i2, i3, i4);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 4294967295, 755, %u, 31, 15, 5, -42; got %u, %o, %u, %d, %d, %d, %d (return: %d)\n",
+               UINT_MAX, u, o, minus, i1, i2, i3, i4, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Leading 0 that fills the whole width\n");
+    unsigned int zero = 1;
+    char rest[16] = "";
+    prepare_test_input("test_data.txt", 128, "temp_input.txt");
+    orig_stdin = setup_input_from_file("temp_input.txt");
+    result = my_scanf("%1x%s", &zero, rest);
+    restore_stdin(orig_stdin);
+    // Same thing through the window of an in-memory record, %2i with the sign
+    const char *signed_zero = "-0abc\n";
+    int window_zero = 1;
+    char window_rest[16] = "";
+    my_scan_index zero_index;
+    my_scan_index_build(&zero_index, signed_zero, strlen(signed_zero));
+    int window_result = my_scan_index_record(&zero_index, 0, "%2i%s", &window_zero, window_rest);
+    my_scan_index_free(&zero_index);
+    if (result == 2 && zero == 0 && strcmp(rest, "abc") == 0 &&
+        window_result == 2 && window_zero == 0 && strcmp(window_rest, "abc") == 0) {
+        printf("   PASSED - Values: %u \"%s\", %d \"%s\"\n", zero, rest, window_zero, window_rest);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 0 \"abc\" twice; got %u \"%s\" (return: %d), %d \"%s\" (return: %d)\n",
+               zero, rest, result, window_zero, window_rest, window_result);
+        tests_failed++;
+    }
+
+    printf("Running test: No sign for hex and binary\n");
+    unsigned int bits = 7, hex_bits = 7;
+    char after[16] = "untouched";
+    prepare_test_input("test_data.txt", 133, "temp_input.txt");
+    orig_stdin = setup_input_from_file("temp_input.txt");
+    result = my_scanf("%b%s", &bits, after);
+    restore_stdin(orig_stdin);
+    const char *signed_hex = "+1f\n";
+    my_scan_index hex_index;
+    my_scan_index_build(&hex_index, signed_hex, strlen(signed_hex));
+    int hex_result = my_scan_index_record(&hex_index, 0, "%x", &hex_bits);
+    my_scan_index_free(&hex_index);
+    if (result == 0 && bits == 7 && strcmp(after, "untouched") == 0 && hex_result == 0 && hex_bits == 7) {
+        printf("   PASSED - Both stopped at the sign\n");
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected both to fail; got %u (return: %d), %u (return: %d)\n", bits, result, hex_bits, hex_result);
+        tests_failed++;
+    }
+
+    printf("Running test: Long integers of every base from memory\n");
+    const char *data = "18446744073709551615 1777777777777777777777 0x0123456789abcdef 12345678901234567 07654321076543210\n";
+    unsigned long long dec = 0, oct = 0, hex = 0;
+    long long auto_dec = 0, auto_oct = 0;
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    result = my_scan_index_record(&index, 0, "%llu %llo %lli %lli %lli", &dec, &oct, &hex, &auto_dec, &auto_oct);
+    my_scan_index_free(&index);
+    if (result == 5 && dec == ULLONG_MAX && oct == ULLONG_MAX && hex == 0x0123456789abcdefULL &&
+        auto_dec == 12345678901234567LL && auto_oct == 07654321076543210LL) {
+        printf("   PASSED - Values: %llu, %llo, %llx, %lld, %llo\n", dec, oct, hex, auto_dec, auto_oct);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Got %llu, %llo, %llx, %lld, %llo (return: %d)\n", dec, oct, hex, auto_dec, auto_oct, result);
+        tests_failed++;
+    }
+}
+
+#ifdef __SIZEOF_INT128__
+void test_wide_integers() {
+    unsigned __int128 id = 0;
+    __int128 low = 0, small = 0;
+    unsigned __int128 expected_id = ((unsigned __int128)0x0123456789abcdefULL << 64) | 0xfedcba9876543210ULL;
+    __int128 expected_low = -(__int128)(((unsigned __int128)1 << 127) - 1) - 1;
+
+    printf("Running test: 128-bit hex and decimal integers\n");
+    prepare_test_input("test_data.txt", 104, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%w128x %w128d %w128d", &id, &low, &small);
+    restore_stdin(orig_stdin);
+    if (result == 3 && id == expected_id && low == expected_low && small == 42) {
+        printf("   PASSED - High: %llx, Low: %llx, Small: %d\n",
+               (unsigned long long)(id >> 64), (unsigned long long)id, (int)small);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 0123456789abcdef fedcba9876543210, INT128_MIN, 42; got %llx %llx, %d (return: %d)\n",
+               (unsigned long long)(id >> 64), (unsigned long long)id, (int)small, result);
+        tests_failed++;
+    }
+
+    printf("Running test: 128-bit integers from memory\n");
+    const char *data = "340282366920938463463374607431768211455 340282366920938463463374607431768211456 7\n";
+    unsigned __int128 max = 0, too_big = 0, seven = 0;
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    my_scan_set_overflow(MY_SCAN_OVERFLOW_SATURATE);
+    result = my_scan_index_record(&index, 0, "%w128u %w128u %w128u", &max, &too_big, &seven);
+    int overflowed = my_scan_overflowed();
+    my_scan_set_overflow(MY_SCAN_OVERFLOW_WRAP);
+    my_scan_index_free(&index);
+    if (result == 3 && max == ~(unsigned __int128)0 && too_big == max && seven == 7 && overflowed == 1) {
+        printf("   PASSED - Largest value read and saturated, small value: %d\n", (int)seven);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected the largest value twice and 7 with 1 overflow; got %d overflows (return: %d)\n",
+               overflowed, result);
+        tests_failed++;
+    }
+}
+#endif
+
 void test_basic_float() {
     float val;
 
@@ -617,6 +819,467 @@ void test_float_suppress_assignment() {
         tests_failed++;
     }
 }
+
+void test_hex_floats() {
+    float f;
+    double d, largest;
+    long double tenth;
+
+    printf("Running test: Hex floats and exact long double\n");
+    prepare_test_input("test_data.txt", 105, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%a %lA %la %Lf", &f, &d, &largest, &tenth);
+    restore_stdin(orig_stdin);
+    if (result == 4 && f == 12.0f && d == -0.25 && largest == DBL_MAX && tenth == 0.1L) {
+        printf("   PASSED - Values: %a, %a, %a, %La\n", f, d, largest, tenth);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 12, -0.25, DBL_MAX, 0.1L; got %a, %a, %a, %La (return: %d)\n", f, d, largest, tenth, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Hex floats from memory\n");
+    const char *data = "0x1.00000000000008p0 0x123456789abcdef0123p-72 0x1p-1074 0x1.8p1x\n";
+    double tie = 0, long_digits = 0, tiny = 0, limited = 0;
+    char rest[8];
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    result = my_scan_index_record(&index, 0, "%la %la %la %5la%s", &tie, &long_digits, &tiny, &limited, rest);
+    my_scan_index_free(&index);
+    // 0x1.00000000000008 is exactly between two doubles and rounds to even
+    if (result == 5 && tie == 1.0 && long_digits == 0x1.23456789abcdfp+0 && tiny == 0x1p-1074 &&
+        limited == 1.5 && strcmp(rest, "p1x") == 0) {
+        printf("   PASSED - Values: %a, %a, %a, %a then \"%s\"\n", tie, long_digits, tiny, limited, rest);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Got %a, %a, %a, %a (return: %d)\n", tie, long_digits, tiny, limited, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Long hex mantissas rounded for long double\n");
+    const char *wide = "0x5c8a72f7c5336050c3 0xffffffffffffffff8 0x1.0000000000000001p0\n";
+    long double rounded = 0, carried = 0, kept = 0;
+    my_scan_index_build(&index, wide, strlen(wide));
+    result = my_scan_index_record(&index, 0, "%La %La %La", &rounded, &carried, &kept);
+    my_scan_index_free(&index);
+    // Same as strtold, which rounds to nearest even in whatever precision long double has
+    if (result == 3 && rounded == strtold("0x5c8a72f7c5336050c3", NULL) &&
+        carried == strtold("0xffffffffffffffff8", NULL) && kept == strtold("0x1.0000000000000001p0", NULL)) {
+        printf("   PASSED - Values: %La, %La, %La\n", rounded, carried, kept);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Got %La, %La, %La (return: %d)\n", rounded, carried, kept, result);
+        tests_failed++;
+    }
+}
+
+void test_fixed_point() {
+    long long price, change, whole, fraction, cut;
+
+    printf("Running test: Fixed point decimals\n");
+    prepare_test_input("test_data.txt", 106, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%.4D %.2D %.2D %.2D %.2D", &price, &change, &whole, &fraction, &cut);
+    restore_stdin(orig_stdin);
+    if (result == 5 && price == 1234567 && change == -50 && whole == 4200 && fraction == 25 && cut == 1999) {
+        printf("   PASSED - Values: %lld, %lld, %lld, %lld, %lld\n", price, change, whole, fraction, cut);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 1234567, -50, 4200, 25, 1999; got %lld, %lld, %lld, %lld, %lld (return: %d)\n",
+               price, change, whole, fraction, cut, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Fixed point rounding from memory\n");
+    const char *data = "1.235 1.225 1.2251 -2.5 99.995 12345678901.1234567891\n";
+    long long up = 0, tie = 0, above = 0, negative = 0, carry = 0, big = 0;
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    my_scan_set_rounding(MY_SCAN_ROUND_HALF_EVEN);
+    result = my_scan_index_record(&index, 0, "%.2D %.2D %.2D %.0D %.2D %.6D", &up, &tie, &above, &negative, &carry, &big);
+    my_scan_set_rounding(MY_SCAN_ROUND_HALF_UP);
+    long long away = 0;
+    int result2 = my_scan_index_record(&index, 0, "%*s %.2D", &away);
+    my_scan_set_rounding(MY_SCAN_ROUND_TRUNCATE);
+    my_scan_index_free(&index);
+    if (result == 6 && up == 124 && tie == 122 && above == 123 && negative == -2 && carry == 10000 &&
+        big == 12345678901123457LL && result2 == 1 && away == 123) {
+        printf("   PASSED - Values: %lld, %lld, %lld, %lld, %lld, %lld, half up: %lld\n", up, tie, above, negative, carry, big, away);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Got %lld, %lld, %lld, %lld, %lld, %lld, half up: %lld (returns: %d, %d)\n",
+               up, tie, above, negative, carry, big, away, result, result2);
+        tests_failed++;
+    }
+}
+
+void test_timestamps() {
+    long long stamp, epoch, zoned;
+
+    printf("Running test: ISO 8601 timestamps\n");
+    prepare_test_input("test_data.txt", 107, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%T %T %T", &stamp, &epoch, &zoned);
+    restore_stdin(orig_stdin);
+    // 2000-02-29T18:29:59.5Z is 951848999.5 seconds
+    if (result == 3 && stamp == 1792240496789000000LL && epoch == 0 && zoned == 951848999500000000LL) {
+        printf("   PASSED - Values: %lld, %lld, %lld\n", stamp, epoch, zoned);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 1792240496789000000, 0, 951848999500000000; got %lld, %lld, %lld (return: %d)\n",
+               stamp, epoch, zoned, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Timestamps from memory\n");
+    const char *data = "1969-12-31T23:59:59.999999999999Z 2026-02-29T00:00:00Z\n2026-10-17 12:34:56\n";
+    long long before = 0, bad_day = 5, bad_layout = 5;
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    result = my_scan_index_record(&index, 0, "%T %T", &before, &bad_day);
+    int result2 = my_scan_index_record(&index, 1, "%T", &bad_layout);
+    my_scan_index_free(&index);
+    if (result == 1 && before == -1 && bad_day == 5 && result2 == 0 && bad_layout == 5) {
+        printf("   PASSED - Value: %lld, invalid dates rejected\n", before);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected -1 then 2 failures; got %lld (returns: %d, %d)\n", before, result, result2);
+        tests_failed++;
+    }
+
+    printf("Running test: Timestamp range and zones\n");
+    const char *edges = "1677-09-21T00:12:43.145224192Z 1677-09-21T00:12:43.145224191Z\n"
+                        "2262-04-11T23:47:16.854775807Z 2262-04-11T23:47:16.854775808Z\n"
+                        "2000-01-01T00:00:00+05: 2000-01-01T00:00:00+99:99 2000-01-01T00:00:00+24 2000-01-01T00:00:00-23:59\n";
+    long long lowest = 0, highest = 0, too_low = 5, too_high = 5, far_west = 0;
+    long long bad_zones[3] = {5, 5, 5};
+    my_scan_set_overflow(MY_SCAN_OVERFLOW_FAIL);
+    my_scan_index_build(&index, edges, strlen(edges));
+    result = my_scan_index_record(&index, 0, "%T %T", &lowest, &too_low);
+    result2 = my_scan_index_record(&index, 1, "%T %T", &highest, &too_high);
+    int zone_results[4];
+    zone_results[0] = my_scan_index_record(&index, 2, "%T", &bad_zones[0]);
+    zone_results[1] = my_scan_index_record(&index, 2, "%*s %T", &bad_zones[1]);
+    zone_results[2] = my_scan_index_record(&index, 2, "%*s %*s %T", &bad_zones[2]);
+    zone_results[3] = my_scan_index_record(&index, 2, "%*s %*s %*s %T", &far_west);
+    my_scan_index_free(&index);
+    my_scan_set_overflow(MY_SCAN_OVERFLOW_WRAP);
+    // Midnight at -23:59 is 23:59 UTC
+    if (result == 1 && lowest == LLONG_MIN && too_low == 5 && result2 == 1 && highest == LLONG_MAX && too_high == 5 &&
+        zone_results[0] == 0 && zone_results[1] == 0 && zone_results[2] == 0 && bad_zones[0] == 5 && bad_zones[2] == 5 &&
+        zone_results[3] == 1 && far_west == 946771140000000000LL) {
+        printf("   PASSED - Range %lld to %lld, bad zones rejected\n", lowest, highest);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Got %lld, %lld, %lld (returns: %d, %d, zones: %d %d %d %d)\n", lowest, highest, far_west,
+               result, result2, zone_results[0], zone_results[1], zone_results[2], zone_results[3]);
+        tests_failed++;
+    }
+}
+
+void test_ip_addresses() {
+    uint32_t home = 0, gateway = 0;
+    unsigned char v6[16], mapped[16];
+    const unsigned char expected_v6[16] = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0xff, 0x00, 0x00, 0x42, 0x83, 0x29};
+    const unsigned char expected_mapped[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 192, 0, 2, 128};
+
+    printf("Running test: IPv4 and IPv6 addresses\n");
+    prepare_test_input("test_data.txt", 108, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%I %I %lI %lI", &home, &gateway, v6, mapped);
+    restore_stdin(orig_stdin);
+    if (result == 4 && home == 0xC0A80001u && gateway == 0x0A0000FFu &&
+        memcmp(v6, expected_v6, 16) == 0 && memcmp(mapped, expected_mapped, 16) == 0) {
+        printf("   PASSED - Values: %08x, %08x and 2 IPv6 addresses\n", (unsigned)home, (unsigned)gateway);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected c0a80001, 0a0000ff; got %08x, %08x (return: %d)\n", (unsigned)home, (unsigned)gateway, result);
+        tests_failed++;
+    }
+
+    printf("Running test: IP addresses from memory\n");
+    const char *data = "255.255.255.255:8080 1.2.3 256.1.1.1\n10.1.2.3\n";
+    uint32_t broadcast = 0, short_form = 5, too_big = 5, last = 0;
+    int port = 0;
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    result = my_scan_index_record(&index, 0, "%I:%d %I", &broadcast, &port, &short_form);
+    int result2 = my_scan_index_record(&index, 0, "%*s %*s %I", &too_big);
+    int result3 = my_scan_index_record(&index, 1, "%I", &last);
+    my_scan_index_free(&index);
+    if (result == 2 && broadcast == 0xFFFFFFFFu && port == 8080 && short_form == 5 &&
+        result2 == 0 && too_big == 5 && result3 == 1 && last == 0x0A010203u) {
+        printf("   PASSED - Values: %08x port %d, %08x, invalid addresses rejected\n", (unsigned)broadcast, port, (unsigned)last);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Got %08x port %d, %08x (returns: %d, %d, %d)\n", (unsigned)broadcast, port, (unsigned)last,
+               result, result2, result3);
+        tests_failed++;
+    }
+
+    printf("Running test: IP addresses with bad octets\n");
+    const char *bad = "::a.1.2.3 01.2.3.4 ::ffff:1.02.3.4\n";
+    unsigned char bad_v6[16];
+    uint32_t leading_zero = 5;
+    my_scan_index_build(&index, bad, strlen(bad));
+    result = my_scan_index_record(&index, 0, "%lI", bad_v6);
+    result2 = my_scan_index_record(&index, 0, "%*s %I", &leading_zero);
+    result3 = my_scan_index_record(&index, 0, "%*s %*s %lI", bad_v6);
+    my_scan_index_free(&index);
+    if (result == 0 && result2 == 0 && leading_zero == 5 && result3 == 0) {
+        printf("   PASSED - Hex digits and leading zeros in octets rejected\n");
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected all 3 rejected; got returns %d, %d, %d\n", result, result2, result3);
+        tests_failed++;
+    }
+}
+
+void test_hex_bytes() {
+    unsigned char uuid[16], tag[4];
+    const unsigned char expected_uuid[16] = {0x12, 0x3e, 0x45, 0x67, 0xe8, 0x9b, 0x12, 0xd3,
+                                             0xa4, 0x56, 0x42, 0x66, 0x14, 0x17, 0x40, 0x00};
+    const unsigned char expected_tag[4] = {0xde, 0xad, 0xbe, 0xef};
+
+    printf("Running test: UUID and hex bytes\n");
+    prepare_test_input("test_data.txt", 109, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%U %4U", uuid, tag);
+    restore_stdin(orig_stdin);
+    if (result == 2 && memcmp(uuid, expected_uuid, 16) == 0 && memcmp(tag, expected_tag, 4) == 0) {
+        printf("   PASSED - UUID and 4 bytes decoded\n");
+        tests_passed++;
+    } else {
+        printf("   FAILED - Bytes didn't match (return: %d)\n", result);
+        tests_failed++;
+    }
+
+    printf("Running test: Hex digests from memory\n");
+    const char *data = "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855 123e4567-e89b-12d3-a456-42661417400 abc\n";
+    unsigned char digest[32], uuid2[16], odd[2];
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    result = my_scan_index_record(&index, 0, "%32U %U", digest, uuid2);
+    int result2 = my_scan_index_record(&index, 0, "%*s %*s %2U", odd);
+    my_scan_index_free(&index);
+    if (result == 1 && digest[0] == 0xe3 && digest[15] == 0x24 && digest[31] == 0x55 && result2 == 0) {
+        printf("   PASSED - Digest decoded, short UUID and odd digits rejected\n");
+        tests_passed++;
+    } else {
+        printf("   FAILED - Got %02x %02x %02x (returns: %d, %d)\n", digest[0], digest[15], digest[31], result, result2);
+        tests_failed++;
+    }
+}
+
+void test_base64() {
+    unsigned char hello[32], short_one[8];
+    size_t hello_length = 0, short_length = 0;
+
+    printf("Running test: Base64 into a buffer\n");
+    prepare_test_input("test_data.txt", 110, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%Z %Z", hello, &hello_length, short_one, &short_length);
+    restore_stdin(orig_stdin);
+    if (result == 2 && hello_length == 11 && memcmp(hello, "hello world", 11) == 0 &&
+        short_length == 2 && memcmp(short_one, "Hi", 2) == 0) {
+        printf("   PASSED - Decoded \"%.11s\" and \"%.2s\"\n", hello, short_one);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected \"hello world\" and \"Hi\"; got %zu and %zu bytes (return: %d)\n",
+               hello_length, short_length, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Base64 from memory into an arena\n");
+    const char *data = "TWFueSBoYW5kcyBtYWtlIGxpZ2h0IHdvcmsu SGk\n";
+    unsigned char *payload = NULL;
+    unsigned char unpadded[8];
+    size_t payload_length = 0, unpadded_length = 0;
+    char memory[64];
+    my_scan_arena arena;
+    my_scan_arena_init(&arena, memory, sizeof(memory));
+    my_scan_set_arena(&arena);
+    my_scan_set_base64(MY_SCAN_BASE64_STRICT);
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    result = my_scan_index_record(&index, 0, "%mZ %Z", &payload, &payload_length, unpadded, &unpadded_length);
+    my_scan_index_free(&index);
+    my_scan_set_base64(MY_SCAN_BASE64_LENIENT);
+    my_scan_set_arena(NULL);
+    if (result == 1 && payload_length == 27 && memcmp(payload, "Many hands make light work.", 27) == 0 &&
+        (char *)payload >= memory && (char *)payload < memory + sizeof(memory)) {
+        printf("   PASSED - Decoded \"%.27s\" into the arena, strict mode rejected missing padding\n", payload);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Got %zu bytes (return: %d)\n", payload_length, result);
+        tests_failed++;
+    }
+    my_scan_arena_reset(&arena);
+}
+
+void test_counted_arrays() {
+    int numbers[4], number_count = 0, float_count = 0;
+    double floats[2];
+
+    printf("Running test: Counted arrays\n");
+    prepare_test_input("test_data.txt", 111, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%#4d %#2lf", &number_count, numbers, &float_count, floats);
+    restore_stdin(orig_stdin);
+    if (result == 2 && number_count == 3 && numbers[0] == 10 && numbers[1] == 20 && numbers[2] == 30 &&
+        float_count == 2 && floats[0] == 1.5 && floats[1] == 2.5) {
+        printf("   PASSED - %d ints and %d doubles\n", number_count, float_count);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 3 ints and 2 doubles; got %d and %d (return: %d)\n", number_count, float_count, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Allocated and too long arrays from memory\n");
+    const char *data = "5 1 2 3 4 0x10 4 1 2 3 4\n";
+    long long *allocated = NULL;
+    int allocated_count = 0, small[2], small_count = 0;
+    char memory[64];
+    my_scan_arena arena;
+    my_scan_arena_init(&arena, memory, sizeof(memory));
+    my_scan_set_arena(&arena);
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    result = my_scan_index_record(&index, 0, "%#mlli %#2d", &allocated_count, &allocated, &small_count, small);
+    my_scan_index_free(&index);
+    my_scan_set_arena(NULL);
+    if (result == 1 && allocated_count == 5 && allocated[0] == 1 && allocated[4] == 16 && small_count == 0) {
+        printf("   PASSED - %d long longs in the arena, too long array rejected\n", allocated_count);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 5 long longs then a failure; got %d (return: %d)\n", allocated_count, result);
+        tests_failed++;
+    }
+    my_scan_arena_reset(&arena);
+
+    printf("Running test: Allocated long double arrays are aligned\n");
+    const char *wide = "a 2 1.5 2.5 3 1 2 3\n";
+    long double *in_arena = NULL, *in_block = NULL;
+    int in_arena_count = 0, in_block_count = 0;
+    // Start the arena off at an odd address and make it too small for the second array
+    my_scan_arena_init(&arena, memory + 1, 48);
+    my_scan_set_arena(&arena);
+    my_scan_index_build(&index, wide, strlen(wide));
+    result = my_scan_index_record(&index, 0, "%*c%#mLf %#mLf", &in_arena_count, &in_arena, &in_block_count, &in_block);
+    my_scan_index_free(&index);
+    my_scan_set_arena(NULL);
+    if (result == 2 && in_arena_count == 2 && in_arena[1] == 2.5L && in_block_count == 3 && in_block[2] == 3.0L &&
+        (uintptr_t)in_arena % _Alignof(long double) == 0 && (uintptr_t)in_block % _Alignof(long double) == 0) {
+        printf("   PASSED - Both arrays aligned for long double\n");
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 2 and 3 aligned long doubles; got %d and %d at %p, %p (return: %d)\n",
+               in_arena_count, in_block_count, (void *)in_arena, (void *)in_block, result);
+        tests_failed++;
+    }
+    my_scan_arena_reset(&arena);
+}
+
+void test_repetition_groups() {
+    int ids[4], values[4], pairs = 0, value_count = 0;
+    float weights[4];
+    char end[8];
+
+    printf("Running test: Repetition groups\n");
+    prepare_test_input("test_data.txt", 112, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%4{(%d,%f)%|,%};%4{ %d%}%s", &pairs, ids, weights, &value_count, values, end);
+    restore_stdin(orig_stdin);
+    if (result == 3 && pairs == 3 && ids[0] == 1 && ids[2] == 5 && weights[1] == 4.5f &&
+        value_count == 3 && values[0] == 7 && values[2] == 9 && strcmp(end, "end") == 0) {
+        printf("   PASSED - %d pairs and %d values, then \"%s\"\n", pairs, value_count, end);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 3 pairs and 3 values; got %d and %d (return: %d)\n", pairs, value_count, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Repetition groups from memory\n");
+    const char *data = "a=1;b=2;c=3 x=1;y 1,2,3,;\n";
+    char *keys[4];
+    int numbers[4], entries = 0, broken = 5, listed = 0, unlimited = 5;
+    char rest[8] = "";
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    result = my_scan_index_record(&index, 0, "%4{%1mc=%d%|;%}", &entries, keys, numbers);
+    // The broken repetition and the ; before it are left for %s
+    int result2 = my_scan_index_record(&index, 0, "%*s %4{%*c=%d%|;%}%7s", &broken, numbers, rest);
+    // So is the separator after the last number
+    int result3 = my_scan_index_record(&index, 0, "%*s %*s %4{%d%|,%},;", &listed, numbers);
+    // Storing without a width could run past the end of the arrays
+    int result4 = my_scan_index_record(&index, 0, "%*s %*s %{%d%|,%}", &unlimited, numbers);
+    my_scan_index_free(&index);
+    if (result == 1 && entries == 3 && keys[0][0] == 'a' && keys[2][0] == 'c' && numbers[1] == 2 &&
+        result2 == 2 && broken == 1 && strcmp(rest, ";y") == 0 && result3 == 1 && listed == 3 &&
+        result4 == 0 && unlimited == 5) {
+        printf("   PASSED - %d entries, broken repetition and trailing separator given back\n", entries);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 3 entries, 1 then \";y\", 3 and no group without width; got %d, %d \"%s\", %d, %d (returns: %d, %d, %d, %d)\n",
+               entries, broken, rest, listed, unlimited, result, result2, result3, result4);
+        tests_failed++;
+    }
+    for (int i = 0; i < entries && i < 4; i++) {
+        free(keys[i]);
+    }
+}
+
+void test_scan_any() {
+    const char *formats[] = {"PUT %63s %d %d", "GET %63s %d", "ERR %63N"};
+    char put_path[64] = "", get_path[64] = "", error[64] = "";
+    int put_status = 0, put_size = 0, get_status = 0;
+    int which[5];
+    int results[5];
+
+    printf("Running test: Dispatching lines to several formats\n");
+    prepare_test_input_multiline("test_data.txt", 112, 4, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    for (int i = 0; i < 5; i++) {
+        results[i] = my_scan_any(formats, 3, &which[i], put_path, &put_status, &put_size, get_path, &get_status, error);
+    }
+    restore_stdin(orig_stdin);
+    my_scan_any_free();
+    if (results[0] == 2 && which[0] == 1 && strcmp(get_path, "/index.html") == 0 && get_status == 200 &&
+        results[1] == 1 && which[1] == 2 && strcmp(error, "disk full 3") == 0 &&
+        results[2] == 3 && which[2] == 0 && strcmp(put_path, "/upload") == 0 && put_status == 201 && put_size == 512 &&
+        results[3] == 0 && which[3] == -1 && results[4] == EOF) {
+        printf("   PASSED - Formats: %d, %d, %d, then no match and EOF\n", which[0], which[1], which[2]);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected formats 1, 2, 0, -1 then EOF; got %d, %d, %d, %d (returns: %d, %d, %d, %d, %d)\n",
+               which[0], which[1], which[2], which[3], results[0], results[1], results[2], results[3], results[4]);
+        tests_failed++;
+    }
+
+    printf("Running test: Dispatching needs the whole line and follows the formats\n");
+    const char *set[2] = {"%d", "%d %s"};
+    int number = 0, other = 0;
+    char word[8] = "";
+    int which_first, which_second;
+    prepare_test_input_multiline("test_data.txt", 125, 2, "temp_input.txt");
+    orig_stdin = setup_input_from_file("temp_input.txt");
+    int first = my_scan_any(set, 2, &which_first, &number, &other, word);
+    // Same array, different formats in it
+    set[0] = "%d %s";
+    set[1] = "%d";
+    int second = my_scan_any(set, 2, &which_second, &other, word, &number);
+    restore_stdin(orig_stdin);
+    my_scan_any_free();
+    if (first == 2 && which_first == 1 && strcmp(word, "abc") == 0 &&
+        second == 1 && which_second == 1 && number == 7) {
+        printf("   PASSED - Formats: %d, %d\n", which_first, which_second);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected formats 1, 1; got %d, %d (returns: %d, %d)\n", which_first, which_second, first, second);
+        tests_failed++;
+    }
+}
+
 void test_basic_string() {
     char str[100];
 
@@ -708,6 +1371,64 @@ void test_string_suppress() {
     }
 }
 
+void test_string_window() {
+    char str1[200], str2[200];
+
+    printf("Running test: String width then rest of token\n");
+    prepare_test_input("test_data.txt", 38, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%3s%s", str1, str2);
+    restore_stdin(orig_stdin);
+    if (result == 2 && strcmp(str1, "hel") == 0 && strcmp(str2, "loworld") == 0) {
+        printf("   PASSED - Values: '%s', '%s'\n", str1, str2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 'hel', 'loworld'; got '%s', '%s' (return: %d)\n", str1, str2, result);
+        tests_failed++;
+    }
+
+    // Long enough that the token end is found by the 16 byte compare, not the leftover loop
+    const char *data = "  a_rather_long_token_name\tand_another_one_after_the_tab_xx \n";
+    my_scan_index index;
+
+    printf("Running test: Long strings from memory\n");
+    my_scan_index_build(&index, data, strlen(data));
+    result = my_scan_index_record(&index, 0, "%s %s", str1, str2);
+    if (result == 2 && strcmp(str1, "a_rather_long_token_name") == 0 && strcmp(str2, "and_another_one_after_the_tab_xx") == 0) {
+        printf("   PASSED - Values: '%s', '%s'\n", str1, str2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected two long tokens; got '%s', '%s' (return: %d)\n", str1, str2, result);
+        tests_failed++;
+    }
+
+    printf("Running test: String width then rest of token from memory\n");
+    result = my_scan_index_record(&index, 0, "%20s%s", str1, str2);
+    if (result == 2 && strcmp(str1, "a_rather_long_token_") == 0 && strcmp(str2, "name") == 0) {
+        printf("   PASSED - Values: '%s', '%s'\n", str1, str2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 'a_rather_long_token_', 'name'; got '%s', '%s' (return: %d)\n", str1, str2, result);
+        tests_failed++;
+    }
+    my_scan_index_free(&index);
+
+    printf("Running test: Strings from the push parser\n");
+    int records = 0;
+    my_scan_push *ctx = my_scan_push_create("%s %s", count_record, &records, str1, str2);
+    my_scan_push_feed(ctx, data, 30);
+    my_scan_push_feed(ctx, data + 30, strlen(data) - 30);
+    my_scan_push_finish(ctx);
+    my_scan_push_free(ctx);
+    if (records == 1 && strcmp(str1, "a_rather_long_token_name") == 0 && strcmp(str2, "and_another_one_after_the_tab_xx") == 0) {
+        printf("   PASSED - Values: '%s', '%s'\n", str1, str2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected two long tokens; got '%s', '%s' (records: %d)\n", str1, str2, records);
+        tests_failed++;
+    }
+}
+
 void test_basic_hex() {
     int val;
 
@@ -811,13 +1532,48 @@ void test_hex_suppress() {
     }
 }
 
-void test_basic_char() {
-    char c;
+void test_hex_window() {
+    const char *data = "0x1234abcdEF567890 deadBEEF 0X7f 123456789abcdef0123\n";
+    unsigned long long big, wide;
+    unsigned int word, small, narrow;
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
 
-    printf("Running test: Basic character\n");
-    prepare_test_input("test_data.txt", 48, "temp_input.txt");
-    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
-    int result = my_scanf("%c", &c);
+    printf("Running test: 16 digit hex from memory\n");
+    int result = my_scan_index_record(&index, 0, "%llx %x %x %10x%llx", &big, &word, &small, &narrow, &wide);
+    if (result == 5 && big == 0x1234abcdEF567890ULL && word == 0xdeadBEEF && small == 0x7f &&
+        narrow == 0x3456789a && wide == 0xbcdef0123ULL) {
+        printf("   PASSED - Values: %llx, %x, %x, %x, %llx\n", big, word, small, narrow, wide);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 1234abcdef567890, deadbeef, 7f, 3456789a, bcdef0123; got %llx, %x, %x, %x, %llx (return: %d)\n",
+               big, word, small, narrow, wide, result);
+        tests_failed++;
+    }
+    my_scan_index_free(&index);
+
+    printf("Running test: 16 digit hex split across pushes\n");
+    int records = 0;
+    my_scan_push *ctx = my_scan_push_create("%llx", count_record, &records, &big);
+    my_scan_push_feed(ctx, "0x1234abcd", 10);
+    my_scan_push_feed(ctx, "EF567890\n", 9);
+    my_scan_push_free(ctx);
+    if (records == 1 && big == 0x1234abcdEF567890ULL) {
+        printf("   PASSED - Value: %llx\n", big);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 1234abcdef567890, got %llx (records: %d)\n", big, records);
+        tests_failed++;
+    }
+}
+
+void test_basic_char() {
+    char c;
+
+    printf("Running test: Basic character\n");
+    prepare_test_input("test_data.txt", 48, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%c", &c);
     restore_stdin(orig_stdin);
     if (result == 1 && c == 'A') {
         printf("   PASSED - Value: '%c'\n", c);
@@ -890,6 +1646,63 @@ void test_char_suppress() {
     }
 }
 
+void test_char_window() {
+    // 300 character payload between two words, longer than any single copy in the getc loop
+    char data[400];
+    char payload[300];
+    char word1[20], word2[20];
+    strcpy(data, "start ");
+    for (int i = 0; i < 300; i++) {
+        data[6 + i] = (char)('0' + i % 10);
+    }
+    strcpy(data + 306, " end\n");
+
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+
+    printf("Running test: Wide char field from memory\n");
+    int result = my_scan_index_record(&index, 0, "%s %300c%s", word1, payload, word2);
+    int payload_ok = 1;
+    for (int i = 0; i < 300; i++) {
+        if (payload[i] != '0' + i % 10) {
+            payload_ok = 0;
+        }
+    }
+    if (result == 3 && payload_ok && strcmp(word1, "start") == 0 && strcmp(word2, "end") == 0) {
+        printf("   PASSED - Values: '%s', 300 chars, '%s'\n", word1, word2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 'start', 300 chars, 'end'; got '%s', '%s' (return: %d)\n", word1, word2, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Suppressed wide char field from memory\n");
+    result = my_scan_index_record(&index, 0, "%*6c%*300c%s", word2);
+    if (result == 1 && strcmp(word2, "end") == 0) {
+        printf("   PASSED - Value: '%s'\n", word2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 'end', got '%s' (return: %d)\n", word2, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Wide char field split across pushes\n");
+    int records = 0;
+    my_scan_push *ctx = my_scan_push_create("%s %300c%s", count_record, &records, word1, payload, word2);
+    my_scan_push_feed(ctx, data, 100);
+    my_scan_push_feed(ctx, data + 100, strlen(data) - 100);
+    my_scan_push_free(ctx);
+    if (records == 1 && payload[299] == '9' && strcmp(word2, "end") == 0) {
+        printf("   PASSED - Values: '%s', 300 chars, '%s'\n", word1, word2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected one record ending in 'end'; got %d records\n", records);
+        tests_failed++;
+    }
+
+    my_scan_index_free(&index);
+}
+
 void test_mixed_types() {
     int i;
     float f;
@@ -1116,6 +1929,37 @@ void test_binary_suppress() {
     }
 }
 
+void test_binary_window() {
+    // 64 flag bits, then 20 bits, then a field that stops at a non binary character
+    const char *data = "0b1000000000000000000000000000000000000000000000000000000000000001 "
+                       "11110000111100001111 1012\n";
+    unsigned long long flags;
+    unsigned int bits, stopped;
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+
+    printf("Running test: 64 bit binary from memory\n");
+    int result = my_scan_index_record(&index, 0, "%llb %b %b", &flags, &bits, &stopped);
+    if (result == 3 && flags == 0x8000000000000001ULL && bits == 0xF0F0F && stopped == 5) {
+        printf("   PASSED - Values: %llx, %x, %u\n", flags, bits, stopped);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 8000000000000001, f0f0f, 5; got %llx, %x, %u (return: %d)\n", flags, bits, stopped, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Binary field width from memory\n");
+    result = my_scan_index_record(&index, 0, "%*s %18b%b", &bits, &stopped);
+    if (result == 2 && bits == 0x3C3C3 && stopped == 3) {
+        printf("   PASSED - Values: %x, %u\n", bits, stopped);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 3c3c3, 3; got %x, %u (return: %d)\n", bits, stopped, result);
+        tests_failed++;
+    }
+    my_scan_index_free(&index);
+}
+
 void test_basic_boolean() {
     int val;
 
@@ -1475,6 +2319,73 @@ void test_line_with_mixed_types() {
     }
 }
 
+void test_line_window() {
+    char line1[200], line2[200];
+
+    printf("Running test: Line width then rest of line\n");
+    prepare_test_input("test_data.txt", 89, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%4N%N", line1, line2);
+    restore_stdin(orig_stdin);
+    if (result == 2 && strcmp(line1, "This") == 0 && strcmp(line2, " is a very long line") == 0) {
+        printf("   PASSED - Values: '%s', '%s'\n", line1, line2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 'This', ' is a very long line'; got '%s', '%s' (return: %d)\n", line1, line2, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Line width then rest of line from memory\n");
+    const char *data = "This is a very long line\n";
+    my_scan_index index;
+    my_scan_index_build(&index, data, strlen(data));
+    result = my_scan_index_record(&index, 0, "%4N%N", line1, line2);
+    my_scan_index_free(&index);
+    if (result == 2 && strcmp(line1, "This") == 0 && strcmp(line2, " is a very long line") == 0) {
+        printf("   PASSED - Values: '%s', '%s'\n", line1, line2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 'This', ' is a very long line'; got '%s', '%s' (return: %d)\n", line1, line2, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Lines longer than the read window\n");
+    // Two lines of 100000 characters each, more than one window full
+    FILE *fp = fopen("temp_input.txt", "w");
+    for (int line = 0; line < 2; line++) {
+        for (int i = 0; i < 100000; i++) {
+            fputc('a' + (i + line) % 26, fp);
+        }
+        fputc('\n', fp);
+    }
+    fclose(fp);
+    char *long_line = NULL;
+    int records = 0;
+    int lines_ok = 1;
+    // Arena with no memory of its own, every line goes in a block freed by the reset
+    my_scan_arena arena;
+    my_scan_arena_init(&arena, NULL, 0);
+    my_scan_set_arena(&arena);
+    fp = fopen("temp_input.txt", "r");
+    // The callback only counts, check the last line afterwards
+    result = my_scan_each(fp, "%mN", count_record, &records, &long_line);
+    fclose(fp);
+    for (int i = 0; long_line != NULL && i < 100000; i++) {
+        if (long_line[i] != 'a' + (i + 1) % 26) {
+            lines_ok = 0;
+        }
+    }
+    if (result == 2 && records == 2 && long_line != NULL && strlen(long_line) == 100000 && lines_ok) {
+        printf("   PASSED - Records: %d of %zu characters\n", records, strlen(long_line));
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 2 records of 100000 characters; got %d (return: %d)\n", records, result);
+        tests_failed++;
+    }
+    my_scan_arena_reset(&arena);
+    my_scan_set_arena(NULL);
+}
+
 void test_line_suppress() {
     char line1[200], line2[200];
 
@@ -1492,6 +2403,585 @@ void test_line_suppress() {
     }
 }
 
+void test_indexed_records() {
+    // Records are kept in memory here, the index works on any buffer
+    const char *data = "42 3.5 hello\n"
+                       "  -7 2.25 world\n"
+                       "1                                                                          2\n"
+                       "last";
+    my_scan_index index;
+    int val1, val2;
+    float flt;
+    char str[100];
+
+    printf("Running test: Index finds every record\n");
+    int built = my_scan_index_build(&index, data, strlen(data));
+    if (built && index.record_count == 4) {
+        printf("   PASSED - Records: %zu\n", index.record_count);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 4 records, got %zu (built: %d)\n", index.record_count, built);
+        tests_failed++;
+    }
+
+    printf("Running test: Indexed record with leading spaces\n");
+    int result = my_scan_index_record(&index, 1, "%d %f %s", &val1, &flt, str);
+    if (result == 3 && val1 == -7 && flt == 2.25f && strcmp(str, "world") == 0) {
+        printf("   PASSED - Values: %d, %f, '%s'\n", val1, flt, str);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected -7, 2.25, 'world'; got %d, %f, '%s' (return: %d)\n", val1, flt, str, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Indexed whitespace longer than one bitmap word\n");
+    result = my_scan_index_record(&index, 2, "%d %d", &val1, &val2);
+    if (result == 2 && val1 == 1 && val2 == 2) {
+        printf("   PASSED - Values: %d, %d\n", val1, val2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 1, 2; got %d, %d (return: %d)\n", val1, val2, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Indexed record does not run into the next one\n");
+    val2 = 999;
+    result = my_scan_index_record(&index, 0, "%d %f %s %d", &val1, &flt, str, &val2);
+    if (result == 3 && val2 == 999) {
+        printf("   PASSED - Return: %d, Value unchanged: %d\n", result, val2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected return 3 with 999 unchanged, got %d, %d\n", result, val2);
+        tests_failed++;
+    }
+
+    printf("Running test: Indexed record out of range\n");
+    result = my_scan_index_record(&index, 4, "%d", &val1);
+    if (result == EOF) {
+        printf("   PASSED - Return: EOF\n");
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected EOF, got %d\n", result);
+        tests_failed++;
+    }
+
+    my_scan_index_free(&index);
+}
+
+void test_allocated_strings() {
+    char *str1 = NULL, *str2 = NULL;
+
+    printf("Running test: Allocated strings with malloc\n");
+    prepare_test_input("test_data.txt", 39, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%ms %ms", &str1, &str2);
+    restore_stdin(orig_stdin);
+    if (result == 2 && strcmp(str1, "foo") == 0 && strcmp(str2, "bar") == 0) {
+        printf("   PASSED - Values: %s, %s\n", str1, str2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 'foo', 'bar'; got '%s', '%s' (return: %d)\n", str1, str2, result);
+        tests_failed++;
+    }
+    free(str1);
+    free(str2);
+
+    char memory[64];
+    my_scan_arena arena;
+    my_scan_arena_init(&arena, memory, sizeof(memory));
+    my_scan_set_arena(&arena);
+
+    printf("Running test: Allocated line from an arena\n");
+    char *line = NULL;
+    prepare_test_input("test_data.txt", 84, "temp_input.txt");
+    orig_stdin = setup_input_from_file("temp_input.txt");
+    result = my_scanf("%mN", &line);
+    restore_stdin(orig_stdin);
+    if (result == 1 && strcmp(line, "Hello World") == 0 && line == memory && arena.used == 12) {
+        printf("   PASSED - Value: '%s' (%zu bytes of arena used)\n", line, arena.used);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 'Hello World' in 12 bytes of arena; got '%s', %zu (return: %d)\n", line, arena.used, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Allocated chars from an arena\n");
+    char *chars = NULL;
+    prepare_test_input("test_data.txt", 38, "temp_input.txt");
+    orig_stdin = setup_input_from_file("temp_input.txt");
+    result = my_scanf("%5mc", &chars);
+    restore_stdin(orig_stdin);
+    if (result == 1 && strncmp(chars, "hello", 5) == 0 && chars == memory + 12 && arena.used == 17) {
+        printf("   PASSED - Value: '%.5s' (no null terminator)\n", chars);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 'hello' right after the line; got %zu bytes used (return: %d)\n", arena.used, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Arena full falls back to malloc\n");
+    my_scan_arena small;
+    my_scan_arena_init(&small, memory, 4);
+    my_scan_set_arena(&small);
+    prepare_test_input("test_data.txt", 39, "temp_input.txt");
+    orig_stdin = setup_input_from_file("temp_input.txt");
+    result = my_scanf("%ms %ms", &str1, &str2);
+    restore_stdin(orig_stdin);
+    if (result == 2 && strcmp(str1, "foo") == 0 && strcmp(str2, "bar") == 0 && str1 == memory && small.overflow != NULL) {
+        printf("   PASSED - Values: %s, %s (second one outside the arena)\n", str1, str2);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 'foo' in the arena and 'bar' outside; got '%s', '%s' (return: %d)\n", str1, str2, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Arena reset\n");
+    my_scan_arena_reset(&small);
+    my_scan_arena_reset(&arena);
+    if (small.used == 0 && small.overflow == NULL && arena.used == 0) {
+        printf("   PASSED - Arenas empty again\n");
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected empty arenas; got %zu and %zu bytes used\n", small.used, arena.used);
+        tests_failed++;
+    }
+    my_scan_set_arena(NULL);
+}
+
+void test_interned_strings() {
+    const char *data = "GET 200\nPOST 404\nGET 500\n";
+    const char *method1 = NULL, *method2 = NULL, *method3 = NULL;
+    int status;
+    my_scan_index index;
+    my_scan_intern table;
+
+    my_scan_intern_init(&table);
+    my_scan_set_intern(&table);
+    my_scan_index_build(&index, data, strlen(data));
+
+    printf("Running test: Interned strings share one copy\n");
+    int result = my_scan_index_record(&index, 0, "%ks %d", &method1, &status);
+    result += my_scan_index_record(&index, 1, "%ks %d", &method2, &status);
+    result += my_scan_index_record(&index, 2, "%ks %d", &method3, &status);
+    if (result == 6 && method1 == method3 && method1 != method2 && strcmp(method2, "POST") == 0 && table.count == 2) {
+        printf("   PASSED - Values: %s, %s, %s (%zu distinct)\n", method1, method2, method3, table.count);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected GET twice at one address and 2 distinct strings; got %zu (return: %d)\n", table.count, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Interned strings with field width\n");
+    const char *prefix = NULL;
+    result = my_scan_index_record(&index, 1, "%2ks", &prefix);
+    if (result == 1 && strcmp(prefix, "PO") == 0 && table.count == 3) {
+        printf("   PASSED - Value: %s\n", prefix);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 'PO'; got %zu distinct (return: %d)\n", table.count, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Interned strings without a table\n");
+    my_scan_set_intern(NULL);
+    prefix = NULL;
+    result = my_scan_index_record(&index, 0, "%ks", &prefix);
+    if (result == 0 && prefix == NULL) {
+        printf("   PASSED - Return: %d\n", result);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected return 0, got %d\n", result);
+        tests_failed++;
+    }
+
+    my_scan_index_free(&index);
+    my_scan_intern_free(&table);
+}
+
+// Adds up every record my_scan_each hands back
+typedef struct {
+    int records;
+    int sum;
+    int stop_after;
+    int *val1;
+    int *val2;
+} each_totals;
+
+int add_record(void *user_data, int fields) {
+    each_totals *totals = user_data;
+    if (fields == 2) {
+        totals->sum += *totals->val1 + *totals->val2;
+    }
+    totals->records++;
+    return totals->records == totals->stop_after;
+}
+
+void test_scan_each() {
+    int val1, val2;
+    each_totals totals = {0, 0, 0, &val1, &val2};
+
+    printf("Running test: Scan every record of a stream\n");
+    prepare_test_input_multiline("test_data.txt", 98, 3, "temp_input.txt");
+    FILE *fp = fopen("temp_input.txt", "r");
+    int result = my_scan_each(fp, "%d %d", add_record, &totals, &val1, &val2);
+    fclose(fp);
+    if (result == 3 && totals.records == 3 && totals.sum == 21) {
+        printf("   PASSED - Records: %d, Sum: %d\n", result, totals.sum);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 3 records summing to 21; got %d, %d (return: %d)\n", totals.records, totals.sum, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Stop early and continue from the same spot\n");
+    each_totals first = {0, 0, 2, &val1, &val2};
+    each_totals rest = {0, 0, 0, &val1, &val2};
+    fp = fopen("temp_input.txt", "r");
+    int result1 = my_scan_each(fp, "%d %d", add_record, &first, &val1, &val2);
+    int result2 = my_scan_each(fp, "%d %d", add_record, &rest, &val1, &val2);
+    fclose(fp);
+    if (result1 == 2 && first.sum == 10 && result2 == 1 && rest.sum == 11) {
+        printf("   PASSED - Sums: %d, %d\n", first.sum, rest.sum);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected sums 10, 11; got %d, %d (return: %d, %d)\n", first.sum, rest.sum, result1, result2);
+        tests_failed++;
+    }
+
+    printf("Running test: Scan records that only have suppressed conversions\n");
+    each_totals skipped = {0, 0, 0, &val1, &val2};
+    fp = fopen("temp_input.txt", "r");
+    result = my_scan_each(fp, "%*d %*d", add_record, &skipped);
+    fclose(fp);
+    if (result == 3 && skipped.records == 3 && skipped.sum == 0) {
+        printf("   PASSED - Records: %d\n", result);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 3 records; got %d (return: %d)\n", skipped.records, result);
+        tests_failed++;
+    }
+}
+
+// Collects the words a push parser with "%ms" finishes
+typedef struct {
+    char *word;        // filled in by the parser
+    char words[4][8];
+    int count;
+    int owned;         // the words were malloc'd and we free them
+} word_list;
+
+int add_word(void *user_data, int fields) {
+    word_list *list = user_data;
+    if (fields == 1 && list->count < 4) {
+        strncpy(list->words[list->count], list->word, 7);
+        list->words[list->count][7] = '\0';
+        list->count++;
+    }
+    if (list->owned) {
+        free(list->word);
+    }
+    return 0;
+}
+
+void test_push_parser() {
+    int val1, val2;
+    each_totals totals = {0, 0, 0, &val1, &val2};
+
+    printf("Running test: Push parser with records split mid-number\n");
+    my_scan_push *ctx = my_scan_push_create("%d %d", add_record, &totals, &val1, &val2);
+    int fed = my_scan_push_feed(ctx, "12 3", 4);
+    fed += my_scan_push_feed(ctx, "4\n5", 3);
+    fed += my_scan_push_feed(ctx, " 6\n", 3);
+    int finished = my_scan_push_finish(ctx);
+    my_scan_push_free(ctx);
+    if (fed == 2 && finished == 0 && totals.records == 2 && totals.sum == 57) {
+        printf("   PASSED - Records: %d, Sum: %d\n", totals.records, totals.sum);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 2 records summing to 57; got %d, %d (fed: %d, finished: %d)\n", totals.records, totals.sum, fed, finished);
+        tests_failed++;
+    }
+
+    printf("Running test: Push parser with every field suppressed\n");
+    int skipped = 0;
+    ctx = my_scan_push_create("%*d", count_record, &skipped);
+    fed = my_scan_push_feed(ctx, "1\n2\n3\n", 6);
+    finished = my_scan_push_finish(ctx);
+    my_scan_push_free(ctx);
+    // The newline after the 3 ends it, so finish only sees whitespace
+    if (fed == 3 && finished == 0 && skipped == 3) {
+        printf("   PASSED - Records: %d\n", skipped);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 3 records; got %d (fed: %d, finished: %d)\n", skipped, fed, finished);
+        tests_failed++;
+    }
+
+    printf("Running test: Push parser one byte at a time\n");
+    const char *input = "1 2.5e1\n-3 0.5\n";
+    int val;
+    float flt;
+    float flt_sum = 0;
+    int records = 0;
+    each_totals ignore = {0, 0, 0, &val1, &val2};
+    ctx = my_scan_push_create("%d %f", add_record, &ignore, &val, &flt);
+    for (size_t i = 0; input[i] != '\0'; i++) {
+        int done = my_scan_push_feed(ctx, &input[i], 1);
+        // Only look at the fields once a record is finished
+        if (done == 1) {
+            flt_sum += val * flt;
+            records++;
+        }
+    }
+    records += my_scan_push_finish(ctx);
+    my_scan_push_free(ctx);
+    if (records == 2 && flt_sum == 25.0f - 1.5f) {
+        printf("   PASSED - Records: %d, Sum: %f\n", records, flt_sum);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 2 records summing to 23.5; got %d, %f\n", records, flt_sum);
+        tests_failed++;
+    }
+
+    printf("Running test: Push parser with %%Lf one byte at a time\n");
+    const char *doubles = "1.5 4\n2.25 8\n";
+    long double ld;
+    long double ld_sum = 0;
+    records = 0;
+    ctx = my_scan_push_create("%Lf %d", add_record, &ignore, &ld, &val);
+    for (size_t i = 0; doubles[i] != '\0'; i++) {
+        if (my_scan_push_feed(ctx, &doubles[i], 1) == 1) {
+            ld_sum += ld * val;
+            records++;
+        }
+    }
+    records += my_scan_push_finish(ctx);
+    my_scan_push_free(ctx);
+    if (records == 2 && ld_sum == 24.0L) {
+        printf("   PASSED - Records: %d, Sum: %Lf\n", records, ld_sum);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 2 records summing to 24; got %d, %Lf\n", records, ld_sum);
+        tests_failed++;
+    }
+
+    printf("Running test: Push parser allocating strings one byte at a time\n");
+    const char *text = "hello world ";
+    word_list mallocd = {NULL, {""}, 0, 1};
+    char memory[64];
+    my_scan_arena arena;
+    my_scan_arena_init(&arena, memory, sizeof(memory));
+    word_list carved = {NULL, {""}, 0, 0};
+    my_scan_push *ctx_malloc = my_scan_push_create("%ms", add_word, &mallocd, &mallocd.word);
+    my_scan_push *ctx_arena = my_scan_push_create("%ms", add_word, &carved, &carved.word);
+    for (size_t i = 0; text[i] != '\0'; i++) {
+        my_scan_push_feed(ctx_malloc, &text[i], 1);
+        my_scan_set_arena(&arena);
+        my_scan_push_feed(ctx_arena, &text[i], 1);
+        my_scan_set_arena(NULL);
+    }
+    my_scan_push_finish(ctx_malloc);
+    my_scan_push_free(ctx_malloc);
+    my_scan_set_arena(&arena);
+    my_scan_push_finish(ctx_arena);
+    my_scan_set_arena(NULL);
+    my_scan_push_free(ctx_arena);
+    // Only the two finished words may use the arena, "hello\0world\0"
+    if (mallocd.count == 2 && strcmp(mallocd.words[1], "world") == 0 &&
+        carved.count == 2 && strcmp(carved.words[0], "hello") == 0 && arena.used == 12) {
+        printf("   PASSED - Words: %s %s, arena used: %zu\n", carved.words[0], carved.words[1], arena.used);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 2 words and 12 bytes of arena; got %d, %d words and %zu bytes\n",
+               mallocd.count, carved.count, arena.used);
+        tests_failed++;
+    }
+    my_scan_arena_reset(&arena);
+
+    printf("Running test: Push parser interning strings one byte at a time\n");
+    const char *statuses = "status status ";
+    my_scan_intern table;
+    my_scan_intern_init(&table);
+    word_list interned = {NULL, {""}, 0, 0};
+    ctx = my_scan_push_create("%ks", add_word, &interned, &interned.word);
+    my_scan_set_intern(&table);
+    for (size_t i = 0; statuses[i] != '\0'; i++) {
+        my_scan_push_feed(ctx, &statuses[i], 1);
+    }
+    my_scan_push_finish(ctx);
+    my_scan_set_intern(NULL);
+    my_scan_push_free(ctx);
+    if (interned.count == 2 && strcmp(interned.words[1], "status") == 0 && table.count == 1) {
+        printf("   PASSED - Words: %d, distinct strings: %zu\n", interned.count, table.count);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 2 words and 1 distinct string; got %d and %zu\n", interned.count, table.count);
+        tests_failed++;
+    }
+    my_scan_intern_free(&table);
+
+    printf("Running test: Push parser input that doesn't match\n");
+    each_totals bad = {0, 0, 0, &val1, &val2};
+    ctx = my_scan_push_create("%d %d", add_record, &bad, &val1, &val2);
+    fed = my_scan_push_feed(ctx, "1 2\nxyz\n", 9);
+    my_scan_push_free(ctx);
+    if (fed == EOF && bad.records == 1) {
+        printf("   PASSED - Return: EOF after %d record\n", bad.records);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected EOF after 1 record; got %d (records: %d)\n", fed, bad.records);
+        tests_failed++;
+    }
+}
+
+void test_checkpoints() {
+    float number = -1.0f, hex_number = -1.0f, zero = -1.0f;
+    unsigned int hex = 99;
+    char after_number[8] = "", after_hex[8] = "", after_hex_number[8] = "", after_zero[8] = "";
+
+    printf("Running test: Giving back a prefix or exponent without digits\n");
+    prepare_test_input("test_data.txt", 117, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf("%f%7s %x%7s %a%7s %f%7s", &number, after_number, &hex, after_hex,
+                          &hex_number, after_hex_number, &zero, after_zero);
+    restore_stdin(orig_stdin);
+    if (result == 8 && number == 5.0f && strcmp(after_number, "e+x") == 0 && hex == 0 && strcmp(after_hex, "xg") == 0 &&
+        hex_number == 1.0f && strcmp(after_hex_number, "p+z") == 0 && zero == 0.0f && strcmp(after_zero, "xq") == 0) {
+        printf("   PASSED - %g \"%s\", %u \"%s\", %g \"%s\", %g \"%s\"\n", number, after_number, hex, after_hex,
+               hex_number, after_hex_number, zero, after_zero);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 5 \"e+x\", 0 \"xg\", 1 \"p+z\", 0 \"xq\"; got %g \"%s\", %u \"%s\", %g \"%s\", %g \"%s\" (return: %d)\n",
+               number, after_number, hex, after_hex, hex_number, after_hex_number, zero, after_zero, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Record that doesn't match is given back whole\n");
+    int val1, val2;
+    each_totals totals = {0, 0, 0, &val1, &val2};
+    char rest[32] = "";
+    prepare_test_input("test_data.txt", 118, "temp_input.txt");
+    FILE *fp = fopen("temp_input.txt", "r");
+    result = my_scan_each(fp, " (%d,%d)", add_record, &totals, &val1, &val2);
+    char *line = fgets(rest, sizeof(rest), fp);
+    fclose(fp);
+    rest[strcspn(rest, "\n")] = '\0';
+    if (result == 2 && totals.sum == 10 && line != NULL && strcmp(rest, " (oops)") == 0) {
+        printf("   PASSED - %d records, then \"%s\"\n", result, rest);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 2 records then \" (oops)\"; got %d, \"%s\"\n", result, rest);
+        tests_failed++;
+    }
+}
+
+void test_validate() {
+    my_scan_report report;
+
+    printf("Running test: Validate every line against a format\n");
+    prepare_test_input_multiline("test_data.txt", 118, 4, "temp_input.txt");
+    FILE *fp = fopen("temp_input.txt", "r");
+    int result = my_scan_validate(fp, "%3s %d %f", &report);
+    fclose(fp);
+    if (result == 2 && report.lines == 4 && report.violation_count == 2 &&
+        report.violations[0].line == 3 && report.violations[0].offset == 29 && report.violations[0].directive == 2 &&
+        report.violations[1].line == 4 && report.violations[1].offset == 47 && report.violations[1].directive == 5) {
+        printf("   PASSED - %zu lines, bad ones: %zu (byte %zu), %zu (byte %zu)\n", report.lines,
+               report.violations[0].line, report.violations[0].offset, report.violations[1].line, report.violations[1].offset);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected lines 3 and 4 to fail at bytes 29 and 47; got %d of %zu lines\n", result, report.lines);
+        tests_failed++;
+    }
+
+    printf("Running test: Validate empty lines with %%N\n");
+    // "1", two empty lines and "x" without a newline at the end
+    prepare_test_input_multiline("test_data.txt", 128, 4, "temp_input.txt");
+    fp = fopen("temp_input.txt", "r");
+    result = my_scan_validate(fp, "%N", &report);
+    fclose(fp);
+    if (result == 0 && report.lines == 4 && report.violation_count == 0) {
+        printf("   PASSED - %zu lines, no violations\n", report.lines);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected 4 lines and no violations; got %d of %zu lines (first on line %zu)\n",
+               result, report.lines, report.violations[0].line);
+        tests_failed++;
+    }
+
+    printf("Running test: Validate without a report\n");
+    prepare_test_input_multiline("test_data.txt", 118, 2, "temp_input.txt");
+    fp = fopen("temp_input.txt", "r");
+    int valid = my_scan_validate(fp, "%3s %d %f", NULL);
+    fclose(fp);
+    if (valid == 0) {
+        printf("   PASSED - No violations\n");
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected no violations; got %d\n", valid);
+        tests_failed++;
+    }
+}
+
+void test_scan_result() {
+    my_scan_result status;
+    int values[4] = {0, 0, 0, 0};
+
+    printf("Running test: Where and why a scan stopped\n");
+    prepare_test_input_multiline("test_data.txt", 122, 2, "temp_input.txt");
+    FILE *orig_stdin = setup_input_from_file("temp_input.txt");
+    int result = my_scanf_ex(&status, "%d %d %d %d", &values[0], &values[1], &values[2], &values[3]);
+    restore_stdin(orig_stdin);
+    if (result == 3 && status.conversions == 3 && values[2] == 30 && status.consumed == 9 && status.line == 2 &&
+        status.column == 4 && status.directive == 6 && status.failure == MY_SCAN_FAILED_MISMATCH) {
+        printf("   PASSED - Mismatch at directive %d, line %zu column %zu after %zu bytes\n", status.directive,
+               status.line, status.column, status.consumed);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected a mismatch at directive 6, line 2 column 4 after 9 bytes; got %d at directive %d, line %zu column %zu after %zu bytes (return: %d)\n",
+               status.failure, status.directive, status.line, status.column, status.consumed, result);
+        tests_failed++;
+    }
+
+    printf("Running test: Position after a group put back several newlines\n");
+    int listed = 0;
+    prepare_test_input_multiline("test_data.txt", 128, 4, "temp_input.txt");
+    orig_stdin = setup_input_from_file("temp_input.txt");
+    result = my_scanf_ex(&status, "%3{%d%| %}", &listed, values);
+    restore_stdin(orig_stdin);
+    // The separator took all three newlines before %d failed on the x, they all go back
+    if (result == 1 && listed == 1 && values[0] == 1 && status.consumed == 1 && status.line == 1 &&
+        status.column == 2 && status.failure == MY_SCAN_COMPLETE) {
+        printf("   PASSED - Line %zu column %zu after %zu bytes\n", status.line, status.column, status.consumed);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected line 1 column 2 after 1 byte; got line %zu column %zu after %zu bytes (return: %d, failure: %d)\n",
+               status.line, status.column, status.consumed, result, status.failure);
+        tests_failed++;
+    }
+
+    printf("Running test: Overflow, complete match and EOF\n");
+    my_scan_result overflow, complete, end;
+    signed char small = 0;
+    prepare_test_input("test_data.txt", 125, "temp_input.txt");
+    orig_stdin = setup_input_from_file("temp_input.txt");
+    my_scan_set_overflow(MY_SCAN_OVERFLOW_FAIL);
+    my_scanf_ex(&overflow, "%hhd", &small);
+    my_scan_set_overflow(MY_SCAN_OVERFLOW_WRAP);
+    my_scanf_ex(&complete, " %d", &values[0]);
+    my_scanf_ex(&end, "%d", &values[1]);
+    restore_stdin(orig_stdin);
+    if (overflow.failure == MY_SCAN_FAILED_OVERFLOW && overflow.directive == 0 && overflow.consumed == 3 &&
+        complete.failure == MY_SCAN_COMPLETE && complete.directive == -1 && complete.conversions == 1 && values[0] == 5 &&
+        end.failure == MY_SCAN_FAILED_EOF && end.directive == 0 && end.consumed == 1) {
+        printf("   PASSED - Failures: %d, %d, %d\n", overflow.failure, complete.failure, end.failure);
+        tests_passed++;
+    } else {
+        printf("   FAILED - Expected overflow, complete, EOF; got %d, %d, %d\n", overflow.failure, complete.failure, end.failure);
+        tests_failed++;
+    }
+}
+
 int main() {
     printf("=== my_scanf Test Suite - %%d Format Specifier ===\n\n");
 
@@ -1516,6 +3006,17 @@ int main() {
     test_suppress_assignment();
     printf("\n");
 
+    test_integer_overflow();
+    printf("\n");
+
+    test_radix_conversions();
+    printf("\n");
+
+#ifdef __SIZEOF_INT128__
+    test_wide_integers();
+    printf("\n");
+#endif
+
     test_basic_float();
     printf("\n");
 
@@ -1537,6 +3038,42 @@ int main() {
     test_float_suppress_assignment();
     printf("\n");
 
+    test_hex_floats();
+    printf("\n");
+
+    test_fixed_point();
+    printf("\n");
+
+    test_timestamps();
+    printf("\n");
+
+    test_ip_addresses();
+    printf("\n");
+
+    test_hex_bytes();
+    printf("\n");
+
+    test_base64();
+    printf("\n");
+
+    test_counted_arrays();
+    printf("\n");
+
+    test_repetition_groups();
+    printf("\n");
+
+    test_scan_any();
+    printf("\n");
+
+    test_checkpoints();
+    printf("\n");
+
+    test_validate();
+    printf("\n");
+
+    test_scan_result();
+    printf("\n");
+
     test_basic_string();
     printf("\n");
 
@@ -1546,6 +3083,9 @@ int main() {
     test_string_suppress();
     printf("\n");
 
+    test_string_window();
+    printf("\n");
+
     test_basic_hex();
     printf("\n");
 
@@ -1555,6 +3095,9 @@ int main() {
     test_hex_suppress();
     printf("\n");
 
+    test_hex_window();
+    printf("\n");
+
     test_basic_char();
     printf("\n");
 
@@ -1564,6 +3107,9 @@ int main() {
     test_char_suppress();
     printf("\n");
 
+    test_char_window();
+    printf("\n");
+
     test_mixed_types();
     printf("\n");
 
@@ -1582,6 +3128,9 @@ int main() {
     test_binary_suppress();
     printf("\n");
 
+    test_binary_window();
+    printf("\n");
+
     test_basic_boolean();
     printf("\n");
 
@@ -1606,6 +3155,24 @@ int main() {
     test_line_suppress();
     printf("\n");
 
+    test_line_window();
+    printf("\n");
+
+    test_allocated_strings();
+    printf("\n");
+
+    test_indexed_records();
+    printf("\n");
+
+    test_interned_strings();
+    printf("\n");
+
+    test_scan_each();
+    printf("\n");
+
+    test_push_parser();
+    printf("\n");
+
     printf("=== Test Summary ===\n");
     printf("Tests passed: %d\n", tests_passed);
     printf("Tests failed: %d\n", tests_failed);